@@ -0,0 +1,499 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> inc/cl_device_matrix.hpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+// The cl_device_matrix keeps its data resident in a cl::Buffer so that chained
+// operations (A*B*C, iterative methods) run device-to-device. Data is only read
+// back into the host mirror when it is requested via to_host() or get_elem().
+// All work is enqueued on the in-order device queue, so buffers are drawn from
+// the device pool and may be recycled as soon as a temporary goes out of scope.
+//
+// Elementwise operations require the utility kernels (kernels/f32/cl_utils.cl)
+// to be loaded alongside the product kernels:
+//
+//	GPU.kernel_source( "../../kernels/f32/cl_product_f32.cl" );
+//	GPU.kernels.add_source( "../../kernels/f32/cl_utils.cl" );
+//	GPU.kernels.pkp_compile_all();
+//	GPU.build_sources();
+//
+//	cl_device_matrix<float> dA(GPU, A), dB(GPU, B);
+//	cl_matrix<float> C = ( dA * dB * dA ).to_host();
+//
+// A constant operand (e.g. a weight matrix) may be packed once with pack(). It
+// is stored on the device as its transpose and products with it as the right
+// operand run f32_product_v5, which reads both operands contiguously:
+//
+//	cl_device_matrix<float> dW = cl_device_matrix<float>::pack(GPU, W);
+//	cl_matrix<float> Y = ( cl_device_matrix<float>(GPU, X) * dW ).to_host();
+//
+// Accumulating products (blocked algorithms, gradient sums) update a resident 
+// matrix in place with gemm(), which costs one kernel and no extra buffer:
+//
+//	dC.gemm( 1.0f, dA, dB, 1.0f );	// dC += dA * dB
+//
+// Layers may fuse a bias and activation into the product (see cl_epilogue):
+//
+//	cl_device_matrix<float> dY = dX.product( dW, cl_epilogue<float>(CL_ACTIVATION_RELU, b) );
+//
+// Note that the cl_device must outlive all matrices which reference it.
+template <class T>
+class cl_device_matrix {
+
+	public:
+
+		size_t m;	// m-rows
+		size_t n;	// n-cols
+
+		// Device handle and resident (pooled) buffer
+		cl_device* device;
+		std::shared_ptr<cl::Buffer> buffer;
+
+		// Host mirror and synchronization flag
+		cl_matrix<T> host;
+		bool host_valid;
+
+		// Buffer holds the transpose (packed operand for f32_product_v5)
+		bool packed;
+
+		// Constructors
+		cl_device_matrix(cl_device& device, size_t m, size_t n);
+		cl_device_matrix(cl_device& device, cl_matrix<T> A);	// A is moved into the host mirror
+		cl_device_matrix(void);
+		~cl_device_matrix(void);
+
+		// Pack constant right operand (uploaded once as its transpose)
+		static cl_device_matrix<T> pack(cl_device& device, const cl_matrix<T>& B);
+
+		// Host synchronization methods
+		cl_matrix<T>& to_host(void);
+		T get_elem(size_t i, size_t j);
+		void pprint(const char* str = "\0");
+
+		// Operator overloads and dot (device-to-device)
+		cl_device_matrix<T> operator+(const cl_device_matrix<T>& A) const;
+		cl_device_matrix<T> operator-(const cl_device_matrix<T>& A) const;
+		cl_device_matrix<T> operator*(const cl_device_matrix<T>& A) const;
+		cl_device_matrix<T> dot(const cl_device_matrix<T>& A) const;
+
+		// Scalar multiplication (device-to-device)
+		cl_device_matrix<T> operator*(T val) const;
+
+		// Product function (device-to-device, kernel_name = NULL selects by shape)
+		cl_device_matrix<T> product(
+			const cl_device_matrix<T>& B,
+			const char* kernel_name = NULL,
+			cl::NDRange NDR = cl::NDRange(8,8)
+		) const;
+
+		// Product function with fused epilogue (bias, scale, activation)
+		cl_device_matrix<T> product(
+			const cl_device_matrix<T>& B,
+			const cl_epilogue<T>& epilogue,
+			const char* kernel_name = NULL,
+			cl::NDRange NDR = cl::NDRange(8,8)
+		) const;
+
+		// General matrix product in place (this = alpha*A*B + beta*this, then epilogue)
+		void gemm(
+			T alpha,
+			const cl_device_matrix<T>& A,
+			const cl_device_matrix<T>& B,
+			T beta,
+			const char* kernel_name = NULL,
+			cl::NDRange NDR = cl::NDRange(8,8),
+			const cl_epilogue<T>* epilogue = NULL
+		);
+
+	private:
+
+		// Shared launcher for elementwise kernels
+		cl_device_matrix<T> elementwise(const char* kernel_name, const cl_device_matrix<T>& A) const;
+};
+
+// Constructor (uninitialized device buffer)
+template<class T>
+cl_device_matrix<T>::cl_device_matrix(cl_device& device, size_t m, size_t n){
+
+	// Matrix dimensions
+	this->m = m;
+	this->n = n;
+
+	// Device handle
+	this->device = &device;
+	this->host_valid = false;
+	this->packed = false;
+
+	// Allocate resident buffer
+	try {
+		this->buffer = device.get_buffer(CL_MEM_READ_WRITE, sizeof(T)*m*n);
+	}
+
+	// If exception is thrown it will be caught here
+	catch (cl::Error& e) {
+		printf("Runtime Error(%d): %s\n", e.err(), device.get_error_string( e.err() ) );
+		printf("  what(): %s\n", e.what() );
+		exit(1);
+	}
+}
+
+// Constructor from host matrix (upload)
+template<class T>
+cl_device_matrix<T>::cl_device_matrix(cl_device& device, cl_matrix<T> A) :
+	cl_device_matrix(device, A.m, A.n) {
+
+	// Blocking write since A is moved into the host mirror below
+	try {
+		device.queue.enqueueWriteBuffer(*this->buffer, CL_TRUE, 0, sizeof(T)*A.m*A.n, &A.data[0]);
+	}
+
+	// If exception is thrown it will be caught here
+	catch (cl::Error& e) {
+		printf("Runtime Error(%d): %s\n", e.err(), device.get_error_string( e.err() ) );
+		printf("  what(): %s\n", e.what() );
+		exit(1);
+	}
+
+	// Host mirror is already in sync
+	this->host = std::move(A);
+	this->host_valid = true;
+}
+
+// Null constructor
+template<class T>
+cl_device_matrix<T>::cl_device_matrix(void) : m(0), n(0), device(NULL), host_valid(false), packed(false) {}
+
+// Destructor
+template<class T>
+cl_device_matrix<T>::~cl_device_matrix(void) {}
+
+// Pack constant right operand. The buffer holds B^T and the host mirror B.
+template<class T>
+cl_device_matrix<T> cl_device_matrix<T>::pack(cl_device& device, const cl_matrix<T>& B){
+
+	cl_device_matrix<T> P(device, B.transpose());
+	P.m = B.m;
+	P.n = B.n;
+	P.host = B;
+	P.packed = true;
+	return P;
+}
+
+// Read device buffer into host mirror (only if stale)
+template<class T>
+cl_matrix<T>& cl_device_matrix<T>::to_host(void){
+
+	if ( !this->host_valid ){
+
+		try {
+			// Packed buffers are read as the transpose
+			this->host = this->packed ? cl_matrix<T>(this->n, this->m) : cl_matrix<T>(this->m, this->n);
+			this->device->queue.enqueueReadBuffer(*this->buffer, CL_TRUE, 0, sizeof(T)*this->m*this->n, &this->host.data[0]);
+			this->host_valid = true;
+
+			if ( this->packed ){
+				this->host = this->host.transpose();
+			}
+		}
+
+		// If exception is thrown it will be caught here
+		catch (cl::Error& e) {
+			printf("Runtime Error(%d): %s\n", e.err(), this->device->get_error_string( e.err() ) );
+			printf("  what(): %s\n", e.what() );
+			exit(1);
+		}
+	}
+	return this->host;
+}
+
+// Get element method (synchronizes host mirror)
+template<class T>
+T cl_device_matrix<T>::get_elem(size_t i, size_t j){ return this->to_host().get_elem(i, j); }
+
+// Print method (synchronizes host mirror)
+template<class T>
+void cl_device_matrix<T>::pprint(const char* str){ this->to_host().pprint(str); }
+
+// Launch an elementwise kernel: C = f(*this, A)
+template<class T>
+cl_device_matrix<T> cl_device_matrix<T>::elementwise(const char* kernel_name, const cl_device_matrix<T>& A) const {
+
+	// Check dimensions
+	if ( this->m != A.m || this->n != A.n ){
+		printf(
+			"Unable to broadcast shapes %d(rows) x %d(cols) and %d(rows) x %d(cols)\n",
+			(int)this->m,
+			(int)this->n,
+			(int)A.m,
+			(int)A.n
+		);
+		exit(1);
+	}
+
+	// Check layouts (packed operands are stored transposed)
+	if ( this->packed != A.packed ){
+		printf("Layout error: Elementwise operation on packed and unpacked matrices\n");
+		exit(1);
+	}
+
+	// Result matrix (same layout as operands)
+	cl_device_matrix<T> C(*this->device, this->m, this->n);
+	C.packed = this->packed;
+
+	try {
+
+		// Retrieve Kernel
+		cl::Kernel kernel = this->device->get_kernel(kernel_name);
+
+		// Set kernel args
+		kernel.setArg(0, (const int)(this->m*this->n));
+		kernel.setArg(1, *this->buffer);
+		kernel.setArg(2, *A.buffer);
+		kernel.setArg(3, *C.buffer);
+
+		// Enqueue kernel execute command
+		this->device->queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(this->m*this->n), cl::NullRange);
+	}
+
+	// If exception is thrown it will be caught here
+	catch (cl::Error& e) {
+		printf("Runtime Error(%d): %s\n", e.err(), this->device->get_error_string( e.err() ) );
+		printf("  what(): %s\n", e.what() );
+		exit(1);
+	}
+	return C;
+}
+
+// Operator Overloads (+/-) and dot
+template<class T>
+cl_device_matrix<T> cl_device_matrix<T>::operator+(const cl_device_matrix<T>& A) const {
+	return this->elementwise("f32_add", A);
+}
+
+template<class T>
+cl_device_matrix<T> cl_device_matrix<T>::operator-(const cl_device_matrix<T>& A) const {
+	return this->elementwise("f32_sub", A);
+}
+
+template<class T>
+cl_device_matrix<T> cl_device_matrix<T>::dot(const cl_device_matrix<T>& A) const {
+	return this->elementwise("f32_dot", A);
+}
+
+// Operator overload scalar multiplication (*)
+template<class T>
+cl_device_matrix<T> cl_device_matrix<T>::operator*(T val) const {
+
+	// Result matrix (same layout as operand)
+	cl_device_matrix<T> C(*this->device, this->m, this->n);
+	C.packed = this->packed;
+
+	try {
+
+		// Retrieve Kernel
+		cl::Kernel kernel = this->device->get_kernel("f32_scale");
+
+		// Set kernel args
+		kernel.setArg(0, (const int)(this->m*this->n));
+		kernel.setArg(1, (const float)val);
+		kernel.setArg(2, *this->buffer);
+		kernel.setArg(3, *C.buffer);
+
+		// Enqueue kernel execute command
+		this->device->queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(this->m*this->n), cl::NullRange);
+	}
+
+	// If exception is thrown it will be caught here
+	catch (cl::Error& e) {
+		printf("Runtime Error(%d): %s\n", e.err(), this->device->get_error_string( e.err() ) );
+		printf("  what(): %s\n", e.what() );
+		exit(1);
+	}
+	return C;
+}
+
+// Operator overload matrix multiplication (*)
+template<class T>
+cl_device_matrix<T> cl_device_matrix<T>::operator*(const cl_device_matrix<T>& A) const {
+	return this->product(A);
+}
+
+// Matrix multiplication (device-to-device)
+template<class T>
+cl_device_matrix<T> cl_device_matrix<T>::product(
+	const cl_device_matrix<T>& B, const char* kernel_name, cl::NDRange NDR) const {
+
+	// Check dimensions
+	if ( this->n != B.m ){
+		printf(
+			"Unable to broadcast shapes %d(rows) x %d(cols) and %d(rows) x %d(cols)\n",
+			(int)this->m,
+			(int)this->n,
+			(int)B.m,
+			(int)B.n
+		);
+		exit(1);
+	}
+
+	// Packed right operands are multiplied with f32_product_v5
+	if ( this->packed ){
+		printf("Layout error: Packed matrix can only be the right operand of a product\n");
+		exit(1);
+	}
+	if ( B.packed ){
+		kernel_name = "f32_product_v5";
+	}
+	else if ( kernel_name && cl_product_find(*this->device, kernel_name) && cl_product_find(*this->device, kernel_name)->packed_B ){
+		printf("Layout error: Kernel (%s) requires a packed right operand (see pack)\n", kernel_name);
+		exit(1);
+	}
+
+	// Result matrix
+	cl_device_matrix<T> C(*this->device, this->m, B.n);
+
+	try {
+		cl_matrix<T>::product_enqueue(
+			*this->device, this->device->queue, kernel_name, NDR,
+			this->m, B.n, this->n, *this->buffer, *B.buffer, *C.buffer );
+	}
+
+	// If exception is thrown it will be caught here
+	catch (cl::Error& e) {
+		printf("Runtime Error(%d): %s\n", e.err(), this->device->get_error_string( e.err() ) );
+		printf("  what(): %s\n", e.what() );
+		exit(1);
+	}
+	return C;
+}
+
+// Matrix multiplication with fused epilogue (device-to-device)
+template<class T>
+cl_device_matrix<T> cl_device_matrix<T>::product(
+	const cl_device_matrix<T>& B, const cl_epilogue<T>& epilogue, const char* kernel_name, cl::NDRange NDR) const {
+
+	cl_device_matrix<T> C(*this->device, this->m, B.n);
+	C.gemm( (T)1, *this, B, (T)0, kernel_name, NDR, &epilogue );
+	return C;
+}
+
+// General matrix product in place: this = alpha*A*B + beta*this. The resident 
+// buffer is accumulated into by the product kernel and the host mirror is 
+// invalidated. If beta is zero the existing values are not read. Note that 
+// copies of a cl_device_matrix share its buffer and are updated as well. An 
+// epilogue (optional) is applied before the store and its scale multiplies alpha.
+template<class T>
+void cl_device_matrix<T>::gemm(
+	T alpha, const cl_device_matrix<T>& A, const cl_device_matrix<T>& B, T beta,
+	const char* kernel_name, cl::NDRange NDR, const cl_epilogue<T>* epilogue ){
+
+	// Check dimensions
+	if ( A.n != B.m || this->m != A.m || this->n != B.n ){
+		printf(
+			"Unable to broadcast product %d(rows) x %d(cols) * %d(rows) x %d(cols) into %d(rows) x %d(cols)\n",
+			(int)A.m,
+			(int)A.n,
+			(int)B.m,
+			(int)B.n,
+			(int)this->m,
+			(int)this->n
+		);
+		exit(1);
+	}
+
+	// Packed right operands are multiplied with f32_product_v5
+	if ( this->packed || A.packed ){
+		printf("Layout error: Packed matrix can only be the right operand of a product\n");
+		exit(1);
+	}
+	if ( B.packed ){
+		kernel_name = "f32_product_v5";
+	}
+	else if ( kernel_name && cl_product_find(*this->device, kernel_name) && cl_product_find(*this->device, kernel_name)->packed_B ){
+		printf("Layout error: Kernel (%s) requires a packed right operand (see pack)\n", kernel_name);
+		exit(1);
+	}
+
+	// Select kernel by shape
+	std::string selected;
+	if ( kernel_name == NULL ){
+		selected = cl_matrix<T>::product_select(*this->device, A.m, B.n, A.n, &NDR);
+		kernel_name = selected.c_str();
+	}
+
+	// Kernel variant applying the epilogue
+	std::string variant_name = kernel_name;
+	const bool has_bias = ( epilogue && !epilogue->bias.empty() );
+	if ( epilogue ){
+
+		if ( has_bias && epilogue->bias.size() != B.n ){
+			printf("Unable to broadcast bias(len=%d) into %d(cols)\n", (int)epilogue->bias.size(), (int)B.n);
+			exit(1);
+		}
+		alpha *= epilogue->scale;
+		variant_name = cl_matrix<T>::product_variant(*this->device, kernel_name, *epilogue);
+	}
+
+	try {
+
+		// Bias (blocking write: the epilogue may not outlive this call)
+		std::shared_ptr<cl::Buffer> buffer_bias;
+		if ( has_bias ){
+			buffer_bias = this->device->get_buffer(CL_MEM_READ_ONLY, sizeof(T)*B.n);
+			this->device->queue.enqueueWriteBuffer(*buffer_bias, CL_TRUE, 0, sizeof(T)*B.n, epilogue->bias.data());
+		}
+
+		// Result aliases an operand: the kernel reads the operand while C is 
+		// written, so the operand is snapshotted into a pooled buffer first
+		std::shared_ptr<cl::Buffer> alias;
+		if ( this->buffer == A.buffer || this->buffer == B.buffer ){
+			alias = this->device->get_buffer(CL_MEM_READ_WRITE, sizeof(T)*this->m*this->n);
+			this->device->queue.enqueueCopyBuffer(*this->buffer, *alias, 0, 0, sizeof(T)*this->m*this->n);
+		}
+		cl::Buffer& buffer_A = ( alias && this->buffer == A.buffer ) ? *alias : *A.buffer;
+		cl::Buffer& buffer_B = ( alias && this->buffer == B.buffer ) ? *alias : *B.buffer;
+
+		cl_matrix<T>::product_enqueue(
+			*this->device, this->device->queue, kernel_name, NDR,
+			A.m, B.n, A.n, buffer_A, buffer_B, *this->buffer, alpha, beta,
+			variant_name.c_str(), buffer_bias.get() );
+	}
+
+	// If exception is thrown it will be caught here
+	catch (cl::Error& e) {
+		printf("Runtime Error(%d): %s\n", e.err(), this->device->get_error_string( e.err() ) );
+		printf("  what(): %s\n", e.what() );
+		exit(1);
+	}
+
+	// Host mirror is stale
+	this->host_valid = false;
+}
+
+// Scalar multiplication (lexers)
+template<class T> inline cl_device_matrix<T> operator*( const cl_device_matrix<T>& A, int val){return A.operator*( (T)val );}
+template<class T> inline cl_device_matrix<T> operator*( const cl_device_matrix<T>& A, float val){return A.operator*( (T)val );}
+template<class T> inline cl_device_matrix<T> operator*( const cl_device_matrix<T>& A, double val){return A.operator*( (T)val );}
+template<class T> inline cl_device_matrix<T> operator*( int val, const cl_device_matrix<T>& A){ return A.operator*( (T)val ); }
+template<class T> inline cl_device_matrix<T> operator*( float val, const cl_device_matrix<T>& A){ return A.operator*( (T)val ); }
+template<class T> inline cl_device_matrix<T> operator*( double val, const cl_device_matrix<T>& A){ return A.operator*( (T)val ); }
\ No newline at end of file
@@ -25,6 +25,7 @@
 //
 
 #include <vector>
+#include <algorithm>
 #include <random>
 #include <complex>
 #include <cstddef>
@@ -32,112 +33,193 @@
 #include <cassert>
 #include <iostream>
 
+// Aligned allocator and matrix storage
+#include "./extensions/cl_alloc.cpp"
+
+// Packed host GEMM (cl_matrix::product)
+#include "./extensions/cl_gemm.cpp"
+
+// Elementwise expression templates (+, -, dot, scalar *)
+#include "./extensions/cl_expr.cpp"
+
+// Product epilogues (bias, scale, activation)
+#include "./extensions/cl_epilogue.cpp"
+
 // Class defining cl_matrix type
-template <class T>
-class cl_matrix {
+template <class T, class Alloc = cl_aligned_allocator<T>>
+class cl_matrix : public cl_expr<cl_matrix<T, Alloc>, T> {
 
 	public: 
 	
 		size_t m;	// m-rows 
 		size_t n;	// n-cols
 
-		std::vector<T> data; // matrix as multi-indexable vector
+		cl_storage<T, Alloc> data; // matrix as multi-indexable array (aligned)
 			
 		const char* m_type_t; 	// type
 		size_t m_size_t;  		// size of type <T> for GPU malloc
 		
 		// Constructor
 		cl_matrix(size_t m, size_t n, const bool identity = false);
-		cl_matrix(size_t m, size_t n, T* buffer);
+		cl_matrix(size_t m, size_t n, T* buffer, const bool copy = true);
 		cl_matrix(void);
 		~cl_matrix(void);
 
+		// Copy and move semantics (data is only copied on explicit copy)
+		cl_matrix(const cl_matrix<T, Alloc>& A) = default;
+		cl_matrix(cl_matrix<T, Alloc>&& A) = default;
+		cl_matrix<T, Alloc>& operator=(const cl_matrix<T, Alloc>& A) = default;
+		cl_matrix<T, Alloc>& operator=(cl_matrix<T, Alloc>&& A) = default;
+
+		// Evaluate elementwise expression (single fused loop)
+		template<class E> cl_matrix(const cl_expr<E, T>& A);
+		template<class E> cl_matrix<T, Alloc>& operator=(const cl_expr<E, T>& A);
+		T eval(size_t i) const;
+
 		// Setter/Getter methods (elementwise)
-		T get_elem(size_t i, size_t j);
+		T get_elem(size_t i, size_t j) const;
 		void set_elem(size_t i, size_t j, T val);
 
 		// Update methods
-		void update_row(size_t k, std::vector<T> data);
-		void update_col(size_t k, std::vector<T> data);
+		void update_row(size_t k, const std::vector<T>& data);
+		void update_col(size_t k, const std::vector<T>& data);
 
 		// Fill rand method
 		void fill_rand(T a, T b, T norm = 1.0);
 		void fill_ints();
 
 		// Exchange methods
-		cl_matrix<T> exchange_row(size_t k, cl_matrix<T> A);
-		cl_matrix<T> exchange_col(size_t k, cl_matrix<T> A);
+		cl_matrix<T, Alloc> exchange_row(size_t k, const cl_matrix<T, Alloc>& A) const;
+		cl_matrix<T, Alloc> exchange_col(size_t k, const cl_matrix<T, Alloc>& A) const;
 
 		// Swap Methods
-		cl_matrix<T> swap_row(size_t m1, size_t m2);
-		cl_matrix<T> swap_col(size_t n1, size_t n2);
-
-		// Operator overloads and dot 
-		cl_matrix<T> operator+(cl_matrix<T> A);
-		cl_matrix<T> operator-(cl_matrix<T> A);
-		cl_matrix<T> operator*(cl_matrix<T> A);	
-		cl_matrix<T> dot(cl_matrix<T> A);
+		cl_matrix<T, Alloc> swap_row(size_t m1, size_t m2) const;
+		cl_matrix<T, Alloc> swap_col(size_t n1, size_t n2) const;
 
-		// Scalar multiplication
-		cl_matrix<T> operator*(T val);
+		// Operator overloads. Elementwise operators (+, -, dot and scalar *) 
+		// are expression templates defined in extensions/cl_expr.cpp
+		cl_matrix<T, Alloc> operator*(const cl_matrix<T, Alloc>& A) const;	
 		
-		bool operator==(cl_matrix<T> A);
-		bool operator!=(cl_matrix<T> A);
-		cl_matrix<T> operator+=(cl_matrix<T> A);
-		cl_matrix<T> operator-=(cl_matrix<T> A);
+		bool operator==(const cl_matrix<T, Alloc>& A) const;
+		bool operator!=(const cl_matrix<T, Alloc>& A) const;
+		template<class E> cl_matrix<T, Alloc>& operator+=(const cl_expr<E, T>& A);
+		template<class E> cl_matrix<T, Alloc>& operator-=(const cl_expr<E, T>& A);
+
+		// In-place variants (no temporaries)
+		void add_inplace(const cl_matrix<T, Alloc>& A);
+		void sub_inplace(const cl_matrix<T, Alloc>& A);
+		void scale_inplace(T val);
 
 		// Matrix specific calculations 
-		cl_matrix<T> product(cl_matrix<T> A);
-		cl_matrix<T> transpose(void);
-		cl_matrix<T> inv(void);
+		cl_matrix<T, Alloc> product(const cl_matrix<T, Alloc>& A) const;
+		void product_into(const cl_matrix<T, Alloc>& A, cl_matrix<T, Alloc>& C) const;
+		cl_matrix<T, Alloc> transpose(void) const;
+		cl_matrix<T, Alloc> inv(void) const;
+
+		// Host threads used by product (0 = all hardware threads)
+		static void set_host_threads(size_t threads);
+		static size_t get_host_threads(void);
 
 		// Determinant and trace
-		T det(void);
-		T tr(void);
+		T det(void) const;
+		T tr(void) const;
 
 		// Is vector and is_square methods
-		bool is_square(void);
-		bool is_vector(void);
+		bool is_square(void) const;
+		bool is_vector(void) const;
 		
 		// Print methods
 		void config(void);
-		void pprint(const char* str = "\0");
+		void pprint(const char* str = "\0") const;
 
 		// Method to extract datatypes
-		void show_types(void);
+		void show_types(void) const;
+		static const char* type_name(void);
 
 		// GPU Implementations
 		void show_threads(
-			cl_device device, 
+			cl_device& device, 
 			cl::NDRange gNDR, 
 			cl::NDRange lNDR, 
 			cl::NDRange lWPT = cl::NDRange(1,1)
-		);
+		) const;
  
- 		// Product function
-		cl_matrix<T> product(
-			cl_matrix<T> A, 
-			cl_device device, 
-			const char* kernel_name = "cl_product_v0",
+ 		// Product function (kernel_name = NULL selects a kernel by shape)
+		cl_matrix<T, Alloc> product(
+			const cl_matrix<T, Alloc>& A, 
+			cl_device& device, 
+			const char* kernel_name = NULL,
 			cl::NDRange NDR = cl::NDRange(8,8)
+		) const;
+
+		// Product function (into existing result matrix)
+		void product_into(
+			const cl_matrix<T, Alloc>& A, 
+			cl_matrix<T, Alloc>& C,
+			cl_device& device, 
+			const char* kernel_name = NULL,
+			cl::NDRange NDR = cl::NDRange(8,8)
+		) const;
+
+		// Product function with fused epilogue (bias, scale, activation)
+		cl_matrix<T, Alloc> product(
+			const cl_matrix<T, Alloc>& A, 
+			cl_device& device, 
+			const cl_epilogue<T>& epilogue,
+			const char* kernel_name = NULL,
+			cl::NDRange NDR = cl::NDRange(8,8)
+		) const;
+
+		// General matrix product (this = alpha*A*B + beta*this, then epilogue)
+		void gemm(
+			T alpha,
+			const cl_matrix<T, Alloc>& A, 
+			const cl_matrix<T, Alloc>& B,
+			T beta,
+			cl_device& device, 
+			const char* kernel_name = NULL,
+			cl::NDRange NDR = cl::NDRange(8,8),
+			const cl_epilogue<T>* epilogue = NULL
+		);
+
+		// Select product kernel for shape A(M,K)*B(K,N) (tuned shape written to NDR)
+		static std::string product_select(cl_device& device, size_t M, size_t N, size_t K, cl::NDRange* NDR = NULL);
+
+		// Kernel variant applying an epilogue (kernel_name if identity)
+		static std::string product_variant(cl_device& device, const char* kernel_name, const cl_epilogue<T>& epilogue);
+
+		// Enqueue product kernel on device resident buffers
+		static void product_enqueue(
+			cl_device& device,
+			cl::CommandQueue& queue,
+			const char* kernel_name,
+			cl::NDRange NDR,
+			size_t M, size_t N, size_t K,
+			cl::Buffer& buffer_A,
+			cl::Buffer& buffer_B,
+			cl::Buffer& buffer_C,
+			T alpha = 1,
+			T beta = 0,
+			const char* variant_name = NULL,
+			cl::Buffer* buffer_bias = NULL
 		);
 
 };
 
 // Constructor
-template<class T>
-cl_matrix<T>::cl_matrix(size_t m, size_t n, const bool identity){
+template<class T, class Alloc>
+cl_matrix<T, Alloc>::cl_matrix(size_t m, size_t n, const bool identity){
 
 	// Matrix dimensions 
 	this->m = m; 
 	this->n = n;
 
 	// Call to pretty function compiler macro for typestring
-	this->m_type_t = __PRETTY_FUNCTION__;	
+	this->m_type_t = cl_matrix<T, Alloc>::type_name();	
 	this->m_size_t = sizeof(T);
 
-	// Call std::vector<T> constructor
-	this->data = std::vector<T>(this->m*this->n);
+	// Allocate (zero initialized) storage
+	this->data = cl_storage<T, Alloc>(this->m*this->n);
 
 	// If initialized as identity matrix
 	if ( identity )
@@ -146,40 +228,46 @@ cl_matrix<T>::cl_matrix(size_t m, size_t n, const bool identity){
 }	
 
 // Constructor from data
-template<class T>
-cl_matrix<T>::cl_matrix(size_t m, size_t n, T* buffer){
+template<class T, class Alloc>
+cl_matrix<T, Alloc>::cl_matrix(size_t m, size_t n, T* buffer, const bool copy){
 
 	// Matrix dimensions 
 	this->m = m;
 	this->n = n;
 
 	// Call to pretty function compiler macro for typestring
-	this->m_type_t = __PRETTY_FUNCTION__;	
+	this->m_type_t = cl_matrix<T, Alloc>::type_name();	
 	this->m_size_t = sizeof(T);
 
-	// Calculate offset and initialize data
-	this->data = std::vector<T>(buffer, buffer + ( this->m * this->n ) );
+	// Copy data, or adopt buffer (caller retains ownership and must keep
+	// buffer alive for the lifetime of the matrix)
+	if ( copy ){
+		this->data = cl_storage<T, Alloc>(buffer, buffer + ( this->m * this->n ) );
+	}
+	else {
+		this->data = cl_storage<T, Alloc>::adopt(buffer, this->m * this->n);
+	}
 }
 
 // Null constructor 
-template<class T>
-cl_matrix<T>::cl_matrix() {}
+template<class T, class Alloc>
+cl_matrix<T, Alloc>::cl_matrix() : m(0), n(0), m_type_t(cl_matrix<T, Alloc>::type_name()), m_size_t(sizeof(T)) {}
 
 // Destructor
-template<class T>
-cl_matrix<T>::~cl_matrix() {}
+template<class T, class Alloc>
+cl_matrix<T, Alloc>::~cl_matrix() {}
 
 // Get element method
-template<class T>
-T cl_matrix<T>::get_elem(size_t i, size_t j){ return this->data[i*this->n + j]; }
+template<class T, class Alloc>
+T cl_matrix<T, Alloc>::get_elem(size_t i, size_t j) const { return this->data[i*this->n + j]; }
 
 // Set element method
-template<class T>
-void cl_matrix<T>::set_elem(size_t i, size_t j, T val){ this->data[i*this->n + j] = val; }
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::set_elem(size_t i, size_t j, T val){ this->data[i*this->n + j] = val; }
 
 // Update row
-template<class T>
-void cl_matrix<T>::update_row(size_t k, std::vector<T> v){
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::update_row(size_t k, const std::vector<T>& v){
 
 	if(v.size() != this->n)  {
 		printf(
@@ -197,8 +285,8 @@ void cl_matrix<T>::update_row(size_t k, std::vector<T> v){
 }
 
 // Update col
-template<class T>
-void cl_matrix<T>::update_col(size_t k, std::vector<T> v){
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::update_col(size_t k, const std::vector<T>& v){
 
 	if(v.size() != this->m)  {
 		printf(
@@ -216,11 +304,10 @@ void cl_matrix<T>::update_col(size_t k, std::vector<T> v){
 }
 
 // Exchange row
-template<class T>
-cl_matrix<T> cl_matrix<T>::exchange_row(size_t k, cl_matrix<T> A){
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix<T, Alloc>::exchange_row(size_t k, const cl_matrix<T, Alloc>& A) const {
 
-	cl_matrix<T> C(A.m, A.n);
-	C.data = this->data;
+	cl_matrix<T, Alloc> C(*this);
 
 	for (size_t j=0; j<this->n; j++){
 		C.set_elem(k,j, A.get_elem(k,j) ); 
@@ -229,11 +316,10 @@ cl_matrix<T> cl_matrix<T>::exchange_row(size_t k, cl_matrix<T> A){
 }
 
 // Exchange col
-template<class T>
-cl_matrix<T> cl_matrix<T>::exchange_col(size_t k, cl_matrix<T> A){
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix<T, Alloc>::exchange_col(size_t k, const cl_matrix<T, Alloc>& A) const {
 
-	cl_matrix<T> C(A.m, A.n);
-	C.data = this->data;
+	cl_matrix<T, Alloc> C(*this);
 
 	for (size_t j=0; j<this->n; j++){
 		C.set_elem(j,k, A.get_elem(j,k) ); 
@@ -242,11 +328,10 @@ cl_matrix<T> cl_matrix<T>::exchange_col(size_t k, cl_matrix<T> A){
 }
 
 // Swap row
-template<class T>
-cl_matrix<T> cl_matrix<T>::swap_row(size_t m1, size_t m2){
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix<T, Alloc>::swap_row(size_t m1, size_t m2) const {
 
-	cl_matrix<T> C(this->m, this->n);
-	C.data = this->data;
+	cl_matrix<T, Alloc> C(*this);
 
 	for (size_t j=0; j<this->n; j++){
 		C.set_elem(m1, j, this->get_elem(m2, j) );
@@ -256,11 +341,10 @@ cl_matrix<T> cl_matrix<T>::swap_row(size_t m1, size_t m2){
 }
 
 // Swap col
-template<class T>
-cl_matrix<T> cl_matrix<T>::swap_col(size_t m1, size_t m2){
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix<T, Alloc>::swap_col(size_t m1, size_t m2) const {
 
-	cl_matrix<T> C(this->m, this->n);
-	C.data = this->data;
+	cl_matrix<T, Alloc> C(*this);
 
 	for (size_t j=0; j<this->m; j++){
 		C.set_elem(j, m1, this->get_elem(j, m2) );
@@ -270,8 +354,8 @@ cl_matrix<T> cl_matrix<T>::swap_col(size_t m1, size_t m2){
 }
 
 // Fill random method
-template<class T>
-void cl_matrix<T>::fill_rand(T a, T b, T norm){
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::fill_rand(T a, T b, T norm){
 
 	std::random_device rd;  // obtain a random number from hardware
 	std::mt19937 eng(rd()); // seed the generator
@@ -285,8 +369,8 @@ void cl_matrix<T>::fill_rand(T a, T b, T norm){
 }
 
 // Fill unique
-template<class T>
-void cl_matrix<T>::fill_ints( void ){
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::fill_ints( void ){
 	for (size_t i=0; i<this->m; i++){
 		for (size_t j=0; j<this->n; j++){
 			this->set_elem(i,j, i*this->n + j );
@@ -295,76 +379,110 @@ void cl_matrix<T>::fill_ints( void ){
 }
 
 
-// Operator Overloads (+/+=)
-// += version returns '*this' whereas returns 'C'
-template<class T>
-cl_matrix<T> cl_matrix<T>::operator+(cl_matrix<T> A){
+// Evaluate expression into new matrix
+template<class T, class Alloc>
+template<class E>
+cl_matrix<T, Alloc>::cl_matrix(const cl_expr<E, T>& A) : cl_matrix(A.rows(), A.cols()) {
+	this->operator=(A);
+}
 
-	cl_matrix<T> C(A.m, A.n);
+// Evaluate expression into matrix (elements are evaluated in place, so the
+// matrix may appear in the expression: A = A + B)
+template<class T, class Alloc>
+template<class E>
+cl_matrix<T, Alloc>& cl_matrix<T, Alloc>::operator=(const cl_expr<E, T>& A){
 
-	for (size_t i=0; i<this->m; i++){
-		for (size_t j=0; j<this->n; j++){
-			C.set_elem( i, j, this->get_elem(i,j) + A.get_elem(i,j) );
-		}
+	const E& e = A.self();
+
+	if ( this->m != e.m || this->n != e.n ){
+		*this = cl_matrix<T, Alloc>(e.m, e.n);
 	}
-	return C;
+
+	T* data = this->data.data();
+	for (size_t i=0; i<this->m*this->n; i++){
+		data[i] = e.eval(i);
+	}
+	return *this;
 }
 
-template<class T>
-cl_matrix<T> cl_matrix<T>::operator+=(cl_matrix<T> A){ 
+// Element access for expressions (linear index)
+template<class T, class Alloc>
+inline T cl_matrix<T, Alloc>::eval(size_t i) const { return this->data[i]; }
 
-	for (int i=0; i<this->m; i++){
-		for (size_t j=0; j<this->n; j++){
-			this->set_elem( i, j, this->get_elem(i,j) + A.get_elem(i,j) );
-		}
+// Operator Overloads (+=/-=)
+// Expressions are evaluated without temporaries
+template<class T, class Alloc>
+template<class E>
+cl_matrix<T, Alloc>& cl_matrix<T, Alloc>::operator+=(const cl_expr<E, T>& A){ 
+
+	const E& e = A.self();
+	cl_expr_check(*this, e);
+
+	T* data = this->data.data();
+	for (size_t i=0; i<this->m*this->n; i++){
+		data[i] += e.eval(i);
 	}
 	return *this;
 }
 
-// Operator Overloads (-/-=)
-// -= version returns '*this' whereas returns 'C'
-template<class T>
-cl_matrix<T> cl_matrix<T>::operator-(cl_matrix<T> A){
+template<class T, class Alloc>
+template<class E>
+cl_matrix<T, Alloc>& cl_matrix<T, Alloc>::operator-=(const cl_expr<E, T>& A){ 
 
-	cl_matrix<T> C(A.m, A.n);
+	const E& e = A.self();
+	cl_expr_check(*this, e);
 
-	for (size_t i=0; i<this->m; i++){
-		for (size_t j=0; j<this->n; j++){
-			C.set_elem( i, j, this->get_elem(i,j) - A.get_elem(i,j) );
-		}
+	T* data = this->data.data();
+	for (size_t i=0; i<this->m*this->n; i++){
+		data[i] -= e.eval(i);
 	}
-	return C;
+	return *this;
 }
 
-template<class T>
-cl_matrix<T> cl_matrix<T>::operator-=(cl_matrix<T> A){ 
+// In-place addition (this += A)
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::add_inplace(const cl_matrix<T, Alloc>& A){
 
-	for (size_t i=0; i<this->m; i++){
-		for (size_t j=0; j<this->n; j++){
-			this->set_elem( i, j, this->get_elem(i,j) - A.get_elem(i,j) );
-		}
+	cl_expr_check(*this, A);
+
+	for (size_t i=0; i<this->m*this->n; i++){
+		this->data[i] += A.data[i];
 	}
-	return *this;
 }
 
-// Dot method (elementwise multiplicaton)
-template<class T>
-cl_matrix<T> cl_matrix<T>::dot(cl_matrix<T> A){
+// In-place subtraction (this -= A)
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::sub_inplace(const cl_matrix<T, Alloc>& A){
 
-	cl_matrix<T> C(A.m, A.n);
+	cl_expr_check(*this, A);
 
-	for (size_t i=0; i<this->m; i++){
-		for (size_t j=0; j<this->n; j++){
-			C.set_elem(i, j , this->get_elem(i,j)*A.get_elem(i,j) );
-		}
+	for (size_t i=0; i<this->m*this->n; i++){
+		this->data[i] -= A.data[i];
+	}
+}
+
+// In-place scalar multiplication (this *= val)
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::scale_inplace(T val){
+
+	for (size_t i=0; i<this->m*this->n; i++){
+		this->data[i] *= val;
 	}
-	return C;
 }
 
 // Matrix multiplication
 // Note that we will also overload operator*
-template<class T>
-cl_matrix<T> cl_matrix<T>::product(cl_matrix<T> A){
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix<T, Alloc>::product(const cl_matrix<T, Alloc>& A) const {
+
+	cl_matrix<T, Alloc> C;
+	this->product_into(A, C);
+	return C;
+}
+
+// Matrix multiplication into C (C is resized only if its shape differs)
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::product_into(const cl_matrix<T, Alloc>& A, cl_matrix<T, Alloc>& C) const {
 
 	// Check dimensions
 	if (this->n != A.m){
@@ -378,52 +496,46 @@ cl_matrix<T> cl_matrix<T>::product(cl_matrix<T> A){
 		exit(1);
 	}
 
+	// Result aliases an operand (A = A*B)
+	if ( &C == this || &C == &A ){
+		C = this->product(A);
+		return;
+	}
+
 	// Define sizes
 	size_t m = this->m;
 	size_t K = this->n;
 	size_t n = A.n;
 
-	// Result and accumulation buffer
-	cl_matrix<T> C(m, n);
-	T acc;
-
-	// Perform multiplication
-	for (size_t i=0; i<m; i++){
-		for (size_t j=0; j<n; j++){
-			acc = 0;
-			for (size_t k=0; k<K; k++) { 
-				acc += this->get_elem(i, k) * A.get_elem(k, j);
-			}
-			C.set_elem(i,j, acc);
-		}		
+	// Result matrix
+	if ( C.m != m || C.n != n ){
+		C = cl_matrix<T, Alloc>(m, n);
+	}
+	if ( m == 0 || n == 0 ){
+		return;
 	}
-	return C;
-}
 
-// Operator overload matrix multiplication (*)
-template<class T>
-cl_matrix<T> cl_matrix<T>::operator*(cl_matrix<T> A){ 
-	return this->product(A); 
+	// Perform multiplication (packed and register blocked)
+	cl_gemm<T>(m, n, K, this->data.data(), K, A.data.data(), n, &C.data[0], n);
 }
 
-// Operator overload scalar multiplication (*)
-template<class T>
-cl_matrix<T> cl_matrix<T>::operator*(T val){
-
-	cl_matrix<T> C(m, n);
+// Set number of host threads
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::set_host_threads(size_t threads){ cl_host_pool().resize(threads); }
 
-	for (size_t i=0; i<m; i++){
-		for (size_t j=0; j<n; j++){
-			C.set_elem(i, j, val*this->get_elem(i,j) );
-		}
-	}
+// Get number of host threads
+template<class T, class Alloc>
+size_t cl_matrix<T, Alloc>::get_host_threads(void){ return cl_host_pool().size(); }
 
-	return C;
+// Operator overload matrix multiplication (*)
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix<T, Alloc>::operator*(const cl_matrix<T, Alloc>& A) const {
+	return this->product(A); 
 }
 
 // Operator Overloads (==/!=)
-template<class T>
-bool cl_matrix<T>::operator==(cl_matrix<T> A){
+template<class T, class Alloc>
+bool cl_matrix<T, Alloc>::operator==(const cl_matrix<T, Alloc>& A) const {
 
 	// Check matrix dimenstions
 	if (A.m != this->m || A.n != this->n){
@@ -441,20 +553,20 @@ bool cl_matrix<T>::operator==(cl_matrix<T> A){
 	return true;
 }
 
-template<class T>
-bool cl_matrix<T>::operator!=(cl_matrix<T> A){
+template<class T, class Alloc>
+bool cl_matrix<T, Alloc>::operator!=(const cl_matrix<T, Alloc>& A) const {
 	return !this->operator==(A);
 }
 
 // Matrix determinant via LU-decomposition O(n^3)
-template<class T>
-T cl_matrix<T>::det(void){
+template<class T, class Alloc>
+T cl_matrix<T, Alloc>::det(void) const {
 
 	// Assert matrix is square
 	assert( this->is_square() );
 
-	cl_matrix<T> L(this->m, this->n);
-	cl_matrix<T> U(this->m, this->n);
+	cl_matrix<T, Alloc> L(this->m, this->n);
+	cl_matrix<T, Alloc> U(this->m, this->n);
 
 	// Accumulation buffer
 	// det() = Product of diagonal elements of U 
@@ -478,16 +590,16 @@ T cl_matrix<T>::det(void){
 }
 
 // Matrix Inverse via LU-decomposition O(n^3)
-template<class T>
-cl_matrix<T> cl_matrix<T>::inv(void){
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix<T, Alloc>::inv(void) const {
 
 	// Assert matrix is square
 	assert( this->is_square() );
 
 	// Phase 1) Factoring A into LU-matrices
 	// Note LU-symmetry in factoring and inversion routines
-	cl_matrix<T> L(this->m, this->n);
-	cl_matrix<T> U(this->m, this->n);
+	cl_matrix<T, Alloc> L(this->m, this->n);
+	cl_matrix<T, Alloc> U(this->m, this->n);
 
 	for (size_t i = 0; i < this->n; i++) {
 		
@@ -510,8 +622,8 @@ cl_matrix<T> cl_matrix<T>::inv(void){
 	}
 
 	// Phase 2) Inverting the LU-matrices
-	cl_matrix<T> l(this->m, this->n);
-	cl_matrix<T> u(this->m, this->n);
+	cl_matrix<T, Alloc> l(this->m, this->n);
+	cl_matrix<T, Alloc> u(this->m, this->n);
 
 	// Note that we can invert the U matrix by exchanging indices
 	for (size_t i = 0; i<this->n; i++){
@@ -540,21 +652,28 @@ cl_matrix<T> cl_matrix<T>::inv(void){
 	return u.product(l);
 }
 
-template<class T>
-cl_matrix<T> cl_matrix<T>::transpose(void){
+// Matrix transpose (cache blocked). Also used to pack B for f32_product_v5
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix<T, Alloc>::transpose(void) const {
 
-	cl_matrix<T> C(this->n, this->m);
-	for (size_t i=0; i<this->n; i++){
-		for (size_t j=0; j<this->m; j++){
-			C.set_elem( i, j, this->get_elem(j,i) );
+	const size_t BS = 32;
+	cl_matrix<T, Alloc> C(this->n, this->m);
+
+	for (size_t ib=0; ib<this->m; ib+=BS){
+		for (size_t jb=0; jb<this->n; jb+=BS){
+			for (size_t i=ib; i<std::min(ib+BS, this->m); i++){
+				for (size_t j=jb; j<std::min(jb+BS, this->n); j++){
+					C.data[ j*this->m + i ] = this->data[ i*this->n + j ];
+				}
+			}
 		}
 	}
 	return C; 
 }
 
 // Matrix trace 
-template<class T>
-T cl_matrix<T>::tr(void){
+template<class T, class Alloc>
+T cl_matrix<T, Alloc>::tr(void) const {
 
 	T tr = 0;
 	if (this->is_square()){ 
@@ -567,14 +686,18 @@ T cl_matrix<T>::tr(void){
 }
 
 // Print matrix methods
-template<class T> 
-void cl_matrix<T>::show_types(void){ 
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::show_types(void) const { 
 	printf("Template Types:\n\t%s\n\tm_size_t = %d\n\n",this->m_type_t,(int)this->m_size_t); 
 }
 
+// Type string (identical for all constructors)
+template<class T, class Alloc> 
+const char* cl_matrix<T, Alloc>::type_name(void){ return __PRETTY_FUNCTION__; }
+
 // v2) Prints matrix and prepends string
-template<class T>
-void cl_matrix<T>::pprint(const char* str){
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::pprint(const char* str) const {
 
 	printf("%s[[\n",str);
 	for (size_t i=0; i<this->m; i++) {
@@ -587,17 +710,26 @@ void cl_matrix<T>::pprint(const char* str){
 }
 
 // Test properties of the matrix
-template<class T> inline bool cl_matrix<T>::is_square(void){ return (this->m == this->n) ? true : false; }
-template<class T> inline bool cl_matrix<T>::is_vector(void){ return (this->m == 1 || this->n == 1) ? true : false;}
-
-// Scalar multiplication (lexers)
-// Would like 2*A and A*2 to behave as expected
-template<class T> inline cl_matrix<T> operator*( cl_matrix<T> A, int val){return A.operator*( (T)val );}
-template<class T> inline cl_matrix<T> operator*( cl_matrix<T> A, float val){return A.operator*( (T)val );}
-template<class T> inline cl_matrix<T> operator*( cl_matrix<T> A, double val){return A.operator*( (T)val );}
-template<class T> inline cl_matrix<T> operator*( int val, cl_matrix<T> A){ return A.operator*( (T)val ); }
-template<class T> inline cl_matrix<T> operator*( float val, cl_matrix<T> A){ return A.operator*( (T)val ); }
-template<class T> inline cl_matrix<T> operator*( double val, cl_matrix<T> A){ return A.operator*( (T)val ); }
+template<class T, class Alloc> inline bool cl_matrix<T, Alloc>::is_square(void) const { return (this->m == this->n) ? true : false; }
+template<class T, class Alloc> inline bool cl_matrix<T, Alloc>::is_vector(void) const { return (this->m == 1 || this->n == 1) ? true : false;}
+
+// Matrix multiplication of expressions (operands are evaluated first)
+template<class L, class R, class T>
+inline cl_matrix<T> operator*( const cl_expr<L, T>& A, const cl_expr<R, T>& B){ 
+	return cl_matrix<T>(A).product( cl_matrix<T>(B) ); 
+}
+
+// Include product kernel dispatch table
+#include  "./extensions/cl_dispatch.cpp"
 
 // Include OpenCL function overloads
-#include  "./extensions/cl_fp32.cpp"
\ No newline at end of file
+#include  "./extensions/cl_fp32.cpp"
+
+// Include product kernel autotuner
+#include  "./extensions/cl_autotune.cpp"
+
+// Include device resident matrix type
+#include  "./cl_device_matrix.hpp"
+
+// Include batched matrix type
+#include  "./cl_matrix_batch.hpp"
\ No newline at end of file
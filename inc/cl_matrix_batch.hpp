@@ -0,0 +1,294 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> inc/cl_matrix_batch.hpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+// The cl_matrix_batch holds many matrices of the same shape in one contiguous 
+// (aligned) allocation, stride elements apart. Batched products upload the 
+// whole batch once, run a single launch of f32_product_batched (the batch 
+// index is the third NDRange dimension) and read the result back once, rather
+// than paying a transfer and launch per matrix. The batched kernel lives in 
+// kernels/f32/cl_batch_f32.cl and is loaded alongside the product kernels:
+//
+//	GPU.kernel_source( "../../kernels/f32/cl_product_f32.cl" );
+//	GPU.kernels.add_source( "../../kernels/f32/cl_batch_f32.cl" );
+//	GPU.kernels.pkp_compile_all();
+//	GPU.build_sources();
+//
+//	cl_matrix_batch<float> A(4096, 32, 64), B(4096, 64, 32);
+//	cl_matrix_batch<float> C = A.product(B, GPU);
+//
+// A right operand with a single matrix is broadcast over the batch (stride 0).
+template <class T, class Alloc = cl_aligned_allocator<T>>
+class cl_matrix_batch {
+
+	public:
+
+		size_t count;	// number of matrices
+		size_t m;		// m-rows
+		size_t n;		// n-cols
+		size_t stride;	// elements between consecutive matrices (>= m*n)
+
+		cl_storage<T, Alloc> data; // batch as contiguous array (aligned)
+
+		size_t m_size_t;	// size of type <T> for GPU malloc
+
+		// Constructors (stride = 0 packs matrices densely)
+		cl_matrix_batch(size_t count, size_t m, size_t n, size_t stride = 0);
+		cl_matrix_batch(void);
+		~cl_matrix_batch(void);
+
+		// Pointer to matrix b
+		T* matrix(size_t b) { return this->data.data() + b*this->stride; }
+		const T* matrix(size_t b) const { return this->data.data() + b*this->stride; }
+
+		// Setter/Getter methods (matrix)
+		cl_matrix<T, Alloc> get(size_t b) const;
+		void set(size_t b, const cl_matrix<T, Alloc>& A);
+
+		// Setter/Getter methods (elementwise)
+		T get_elem(size_t b, size_t i, size_t j) const;
+		void set_elem(size_t b, size_t i, size_t j, T val);
+
+		// Fill rand method
+		void fill_rand(T a, T b, T norm = 1.0);
+
+		// Batched product C[b] = A[b]*B[b]
+		cl_matrix_batch<T, Alloc> product(
+			const cl_matrix_batch<T, Alloc>& B, 
+			cl_device& device
+		) const;
+
+		// Batched product (into existing result batch)
+		void product_into(
+			const cl_matrix_batch<T, Alloc>& B, 
+			cl_matrix_batch<T, Alloc>& C,
+			cl_device& device
+		) const;
+
+		// Enqueue batched product on device resident buffers
+		static void product_enqueue(
+			cl_device& device, 
+			cl::CommandQueue& queue,
+			size_t count, size_t M, size_t N, size_t K,
+			size_t stride_A, size_t stride_B, size_t stride_C,
+			cl::Buffer& buffer_A, cl::Buffer& buffer_B, cl::Buffer& buffer_C
+		);
+};
+
+// Constructor (zero initialized)
+template<class T, class Alloc>
+cl_matrix_batch<T, Alloc>::cl_matrix_batch(size_t count, size_t m, size_t n, size_t stride){
+
+	// Batch dimensions
+	this->count = count;
+	this->m = m;
+	this->n = n;
+	this->stride = ( stride == 0 ) ? m*n : stride;
+	this->m_size_t = sizeof(T);
+
+	// Check stride
+	if ( this->stride < m*n ){
+		printf("Batch error: Stride (%d) is smaller than matrix %d(rows) x %d(cols)\n", (int)stride, (int)m, (int)n);
+		exit(1);
+	}
+
+	// Allocate (zero initialized) storage
+	this->data = cl_storage<T, Alloc>(this->count*this->stride);
+}
+
+// Null constructor
+template<class T, class Alloc>
+cl_matrix_batch<T, Alloc>::cl_matrix_batch(void) : count(0), m(0), n(0), stride(0), m_size_t(sizeof(T)) {}
+
+// Destructor
+template<class T, class Alloc>
+cl_matrix_batch<T, Alloc>::~cl_matrix_batch(void) { }
+
+// Get matrix (copy)
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix_batch<T, Alloc>::get(size_t b) const {
+	return cl_matrix<T, Alloc>( this->m, this->n, (T*)this->matrix(b) );
+}
+
+// Set matrix (copy)
+template<class T, class Alloc>
+void cl_matrix_batch<T, Alloc>::set(size_t b, const cl_matrix<T, Alloc>& A){
+
+	if ( A.m != this->m || A.n != this->n ){
+		printf(
+			"Unable to broadcast shapes %d(rows) x %d(cols) into batch of %d(rows) x %d(cols)\n",
+			(int)A.m,
+			(int)A.n,
+			(int)this->m,
+			(int)this->n
+		);
+		exit(1);
+	}
+	std::copy( A.data.begin(), A.data.end(), this->matrix(b) );
+}
+
+// Get element method
+template<class T, class Alloc>
+T cl_matrix_batch<T, Alloc>::get_elem(size_t b, size_t i, size_t j) const { return this->matrix(b)[i*this->n + j]; }
+
+// Set element method
+template<class T, class Alloc>
+void cl_matrix_batch<T, Alloc>::set_elem(size_t b, size_t i, size_t j, T val){ this->matrix(b)[i*this->n + j] = val; }
+
+// Fill rand
+template<class T, class Alloc>
+void cl_matrix_batch<T, Alloc>::fill_rand(T a, T b, T norm){
+
+	std::random_device rd;  // obtain a random number from hardware
+	std::mt19937 eng(rd()); // seed the generator
+	std::uniform_int_distribution<> distr((int)a, (int)b); // define the range
+
+	for (size_t k=0; k<this->count; k++){
+		for (size_t i=0; i<this->m; i++){
+			for (size_t j=0; j<this->n; j++){
+				this->set_elem(k,i,j, (T)distr(eng)/norm);
+			}
+		}
+	}
+}
+
+// Batched product
+template<class T, class Alloc>
+cl_matrix_batch<T, Alloc> cl_matrix_batch<T, Alloc>::product(
+	const cl_matrix_batch<T, Alloc>& B, cl_device& device ) const {
+
+	cl_matrix_batch<T, Alloc> C;
+	this->product_into(B, C, device);
+	return C;
+}
+
+// Batched product (into existing result batch). One upload of each operand, 
+// one launch and one readback for the whole batch.
+template<class T, class Alloc>
+void cl_matrix_batch<T, Alloc>::product_into(
+	const cl_matrix_batch<T, Alloc>& B, cl_matrix_batch<T, Alloc>& C, cl_device& device ) const {
+
+	// Reference this as A
+	const cl_matrix_batch<T, Alloc>& A = *this;
+
+	// Check dimensions
+	if ( A.n != B.m ){
+		printf(
+			"Unable to broadcast shapes %d(rows) x %d(cols) and %d(rows) x %d(cols)\n",
+			(int)A.m,
+			(int)A.n,
+			(int)B.m,
+			(int)B.n
+		);
+		exit(1);
+	}
+
+	// Check batch sizes (a single right operand is broadcast)
+	if ( B.count != A.count && B.count != 1 ){
+		printf("Batch error: Unable to broadcast batch of %d into batch of %d\n", (int)B.count, (int)A.count);
+		exit(1);
+	}
+	const size_t stride_B = ( B.count == 1 ) ? 0 : B.stride;
+
+	// Result batch (dense). Results are written asynchronously, so C must not 
+	// alias an operand.
+	if ( &C == &A || &C == &B ){
+		C = A.product(B, device);
+		return;
+	}
+	if ( C.count != A.count || C.m != A.m || C.n != B.n ){
+		C = cl_matrix_batch<T, Alloc>(A.count, A.m, B.n);
+	}
+
+	// Nothing to do
+	if ( A.count == 0 ){
+		return;
+	}
+
+	// Exception handler for OpenCL calls
+	try {
+
+		// Device command queue
+		cl::CommandQueue& queue = device.queue;
+
+		// Pooled staging buffers (whole batch)
+		std::shared_ptr<cl::Buffer> buffer_A = device.get_buffer(CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR,  A.m_size_t*A.data.size());
+		std::shared_ptr<cl::Buffer> buffer_B = device.get_buffer(CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR,  B.m_size_t*B.data.size());
+		std::shared_ptr<cl::Buffer> buffer_C = device.get_buffer(CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, C.m_size_t*C.data.size());
+
+		// non-blocking write to buffers
+		queue.enqueueWriteBuffer(*buffer_A, CL_FALSE, 0, A.m_size_t*A.data.size(), A.data.data());
+		queue.enqueueWriteBuffer(*buffer_B, CL_FALSE, 0, B.m_size_t*B.data.size(), B.data.data());
+
+		// Enqueue the batched product kernel
+		cl_matrix_batch<T, Alloc>::product_enqueue(
+			device, queue, A.count, A.m, B.n, A.n, A.stride, stride_B, C.stride, *buffer_A, *buffer_B, *buffer_C );
+
+		// Blocking read of data into result batch
+		queue.enqueueReadBuffer(*buffer_C, CL_TRUE, 0, C.m_size_t*C.data.size(), C.data.data());
+		queue.finish();
+	}
+
+	// If exception is thrown it will be caught here
+	catch (cl::Error& e) {
+		printf("Runtime Error(%d): %s\n", e.err(), device.get_error_string( e.err() ) );
+		printf("  what(): %s\n", e.what() );
+		exit(1);
+	}
+}
+
+// Enqueue the batched product on device resident buffers. Workgroups are 
+// TILE_SIZE x TILE_SIZE x 1 (PKP) and the batch index is NDRange dimension 2.
+template<class T, class Alloc>
+void cl_matrix_batch<T, Alloc>::product_enqueue(
+	cl_device& device, cl::CommandQueue& queue,
+	size_t count, size_t M, size_t N, size_t K,
+	size_t stride_A, size_t stride_B, size_t stride_C,
+	cl::Buffer& buffer_A, cl::Buffer& buffer_B, cl::Buffer& buffer_C ){
+
+	// Tile size is a compile time constant (PKP)
+	const size_t ts = cl_pkp_size(device, "f32_product_batched", "TILE_SIZE");
+
+	// Calculate NDRange(s) (__gloabl/__local)
+	cl::NDRange G_NDR( cl_round_up(M, ts), cl_round_up(N, ts), count );
+	cl::NDRange L_NDR( ts, ts, 1 );
+
+	// Retrieve Kernel
+	cl::Kernel kernel = device.get_kernel("f32_product_batched");
+
+	// Set kernel args
+	kernel.setArg(0, (const int)M);
+	kernel.setArg(1, (const int)N);
+	kernel.setArg(2, (const int)K);
+	kernel.setArg(3, (const int)stride_A);
+	kernel.setArg(4, (const int)stride_B);
+	kernel.setArg(5, (const int)stride_C);
+	kernel.setArg(6, buffer_A);
+	kernel.setArg(7, buffer_B);
+	kernel.setArg(8, buffer_C);
+
+	// Enqueue kernel execute command
+	queue.enqueueNDRangeKernel( kernel, cl::NullRange, G_NDR, L_NDR );
+}
\ No newline at end of file
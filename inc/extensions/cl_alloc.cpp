@@ -0,0 +1,239 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> inc/extensions/cl_alloc.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+// Standard libraries
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+// POSIX (posix_memalign, madvise)
+#include <sys/mman.h>
+
+// Alignment configuration (bytes)
+#define CL_ALLOC_ALIGN 64
+#define CL_ALLOC_PAGE_SIZE 4096
+#define CL_ALLOC_HUGE_PAGE_SIZE (2*1024*1024)
+
+// Aligned allocator for cl_matrix storage. Allocations are aligned to Align
+// bytes, and to a page once they span at least one page so that the OpenCL
+// runtime may use them directly as host pointers. If HugePages is set then
+// allocations of at least one huge page are aligned to 2MB and advised for
+// transparent huge pages (MADV_HUGEPAGE).
+template<class T, size_t Align = CL_ALLOC_ALIGN, bool HugePages = false>
+class cl_aligned_allocator {
+
+	public:
+
+		typedef T value_type;
+
+		template<class U> struct rebind { typedef cl_aligned_allocator<U, Align, HugePages> other; };
+
+		// Constructors
+		cl_aligned_allocator(void) {}
+		template<class U> cl_aligned_allocator(const cl_aligned_allocator<U, Align, HugePages>&) {}
+
+		// Allocate and free (n elements)
+		T* allocate(size_t n);
+		void deallocate(T* p, size_t n);
+
+		// Stateless: all instances are interchangeable
+		bool operator==(const cl_aligned_allocator&) const { return true; }
+		bool operator!=(const cl_aligned_allocator&) const { return false; }
+};
+
+// Allocate aligned memory
+template<class T, size_t Align, bool HugePages>
+T* cl_aligned_allocator<T, Align, HugePages>::allocate(size_t n){
+
+	size_t bytes = n * sizeof(T);
+	size_t align = std::max( Align, sizeof(void*) );
+
+	if ( bytes >= CL_ALLOC_PAGE_SIZE ){
+		align = std::max( align, (size_t)CL_ALLOC_PAGE_SIZE );
+	}
+
+	if ( HugePages && bytes >= CL_ALLOC_HUGE_PAGE_SIZE ){
+		align = std::max( align, (size_t)CL_ALLOC_HUGE_PAGE_SIZE );
+	}
+
+	void* p = NULL;
+	if ( posix_memalign( &p, align, std::max( bytes, (size_t)1 ) ) != 0 ){
+		throw std::bad_alloc();
+	}
+
+	// Advise kernel to back allocation with huge pages
+#ifdef MADV_HUGEPAGE
+	if ( HugePages && bytes >= CL_ALLOC_HUGE_PAGE_SIZE ){
+		madvise( p, ( bytes / CL_ALLOC_HUGE_PAGE_SIZE ) * CL_ALLOC_HUGE_PAGE_SIZE, MADV_HUGEPAGE );
+	}
+#endif
+
+	return static_cast<T*>(p);
+}
+
+// Free aligned memory
+template<class T, size_t Align, bool HugePages>
+void cl_aligned_allocator<T, Align, HugePages>::deallocate(T* p, size_t n){ free(p); }
+
+// Allocator with transparent huge pages for large matrices
+template<class T>
+using cl_huge_page_allocator = cl_aligned_allocator<T, CL_ALLOC_ALIGN, true>;
+
+// Contiguous storage for cl_matrix. Behaves like a fixed size std::vector
+// (size, data, operator[], begin/end) but may also adopt an externally owned
+// pointer without copying. Adopted memory is never freed by the storage, and
+// copying adopted storage yields an owning deep copy. Assigning storage of the
+// same size copies elements in place. Elements are treated as
+// trivially copyable (arithmetic and std::complex types).
+template<class T, class Alloc>
+class cl_storage {
+
+	public:
+
+		// Constructors
+		cl_storage(void);
+		explicit cl_storage(size_t n);
+		cl_storage(const T* first, const T* last);
+		~cl_storage(void);
+
+		// Adopt external pointer (not owned)
+		static cl_storage<T, Alloc> adopt(T* p, size_t n);
+
+		// Copy and move semantics
+		cl_storage(const cl_storage<T, Alloc>& A);
+		cl_storage(cl_storage<T, Alloc>&& A);
+		cl_storage<T, Alloc>& operator=(const cl_storage<T, Alloc>& A);
+		cl_storage<T, Alloc>& operator=(cl_storage<T, Alloc>&& A);
+
+		// Element access
+		T* data(void) { return this->ptr; }
+		const T* data(void) const { return this->ptr; }
+		T& operator[](size_t i) { return this->ptr[i]; }
+		const T& operator[](size_t i) const { return this->ptr[i]; }
+
+		// Iterators
+		T* begin(void) { return this->ptr; }
+		T* end(void) { return this->ptr + this->len; }
+		const T* begin(void) const { return this->ptr; }
+		const T* end(void) const { return this->ptr + this->len; }
+
+		// Size and ownership
+		size_t size(void) const { return this->len; }
+		bool empty(void) const { return this->len == 0; }
+		bool owns(void) const { return this->owner; }
+
+	private:
+
+		T* ptr;
+		size_t len;
+		bool owner;
+		Alloc alloc;
+
+		// Free owned memory
+		void release(void);
+};
+
+// Null constructor
+template<class T, class Alloc>
+cl_storage<T, Alloc>::cl_storage(void) : ptr(NULL), len(0), owner(false) {}
+
+// Constructor (value initialized)
+template<class T, class Alloc>
+cl_storage<T, Alloc>::cl_storage(size_t n) : ptr(NULL), len(n), owner(true) {
+	this->ptr = this->alloc.allocate(n);
+	std::fill(this->ptr, this->ptr + n, T());
+}
+
+// Constructor (copy range)
+template<class T, class Alloc>
+cl_storage<T, Alloc>::cl_storage(const T* first, const T* last) : ptr(NULL), len(last - first), owner(true) {
+	this->ptr = this->alloc.allocate(this->len);
+	std::copy(first, last, this->ptr);
+}
+
+// Destructor
+template<class T, class Alloc>
+cl_storage<T, Alloc>::~cl_storage(void){ this->release(); }
+
+// Adopt external pointer
+template<class T, class Alloc>
+cl_storage<T, Alloc> cl_storage<T, Alloc>::adopt(T* p, size_t n){
+	cl_storage<T, Alloc> S;
+	S.ptr = p;
+	S.len = n;
+	S.owner = false;
+	return S;
+}
+
+// Copy constructor (always owning)
+template<class T, class Alloc>
+cl_storage<T, Alloc>::cl_storage(const cl_storage<T, Alloc>& A) : cl_storage(A.begin(), A.end()) {}
+
+// Move constructor
+template<class T, class Alloc>
+cl_storage<T, Alloc>::cl_storage(cl_storage<T, Alloc>&& A) : ptr(A.ptr), len(A.len), owner(A.owner) {
+	A.ptr = NULL;
+	A.len = 0;
+	A.owner = false;
+}
+
+// Copy assignment
+template<class T, class Alloc>
+cl_storage<T, Alloc>& cl_storage<T, Alloc>::operator=(const cl_storage<T, Alloc>& A){
+	// Same size: copy elements in place (writes through adopted memory)
+	if ( this->ptr && this->len == A.len ){
+		std::copy(A.begin(), A.end(), this->ptr);
+	}
+	else if ( this != &A ){
+		*this = cl_storage<T, Alloc>(A);
+	}
+	return *this;
+}
+
+// Move assignment
+template<class T, class Alloc>
+cl_storage<T, Alloc>& cl_storage<T, Alloc>::operator=(cl_storage<T, Alloc>&& A){
+	if ( this != &A ){
+		this->release();
+		std::swap(this->ptr, A.ptr);
+		std::swap(this->len, A.len);
+		std::swap(this->owner, A.owner);
+	}
+	return *this;
+}
+
+// Free owned memory
+template<class T, class Alloc>
+void cl_storage<T, Alloc>::release(void){
+	if ( this->owner && this->ptr ){
+		this->alloc.deallocate(this->ptr, this->len);
+	}
+	this->ptr = NULL;
+	this->len = 0;
+	this->owner = false;
+}
\ No newline at end of file
@@ -0,0 +1,251 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> inc/extensions/cl_autotune.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+//
+// AuroraCL product kernel autotuner
+//
+// cl_product_autotune() searches the tuning candidates of every product kernel
+// in the dispatch table (PKP values and workgroup shapes, see extensions/
+// cl_dispatch.cpp) on a set of shapes. The fastest launch for each shape is
+// recorded in the tuning database of the device under its shape bucket, from
+// which cl_product_select() takes it in later runs once the database is stored:
+//
+//	std::vector<cl_product_shape> shapes = { {1024, 1024, 1024}, {64, 64, 8192} };
+//	cl_product_autotune<float>(device, shapes);
+//	device.tuning.store();
+//
+// Each candidate variant is built into a program of its own (see cl_device::
+// get_variant) and timed on every shape before the next one is built, so the
+// digest is not changed by tuning. Candidates which fail to build are skipped.
+// Each launch is checked against f32_product_v0 and launches which fail or 
+// return wrong results are skipped. Operands of all shapes are held on the 
+// device while tuning.
+//
+
+#include <map>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+
+// Product shape A(M,K)*B(K,N)
+struct cl_product_shape {
+	size_t M;
+	size_t N;
+	size_t K;
+};
+
+// Tuning launch: kernel descriptor and candidate
+struct cl_product_trial {
+	const cl_product_launch* launch;
+	cl_product_candidate candidate;
+};
+
+// Operands, reference product and best launch of a tuning shape
+template<class T>
+struct cl_product_tuning {
+	cl_product_shape shape;
+	std::shared_ptr<cl::Buffer> buffer_A;
+	std::shared_ptr<cl::Buffer> buffer_B;
+	std::shared_ptr<cl::Buffer> buffer_C;
+	cl_matrix<T> R;
+	cl_tuning_entry best;
+};
+
+// Autotune product kernels on shapes. Each launch is timed over cycles runs
+// (after one verified warm up run). Returns the number of shapes tuned.
+template<class T>
+size_t cl_product_autotune(cl_device& device, const std::vector<cl_product_shape>& shapes, size_t cycles = 3, bool pprint = false){
+
+	// Candidate launches of every loaded kernel. Kernels taking a packed B are
+	// not selected automatically (see cl_product_select) and are not tuned.
+	std::vector<cl_product_trial> trials;
+	for ( const cl_product_launch& launch : cl_product_registry() ){
+
+		if ( launch.packed_B || launch.candidates == NULL || !device.has_kernel( launch.kernel_name ) ){
+			continue;
+		}
+
+		for ( const cl_product_candidate& candidate : launch.candidates(device, launch.kernel_name) ){
+			trials.push_back( { &launch, candidate } );
+		}
+	}
+
+	// Candidates are timed as built (no shape specialization while tuning)
+	const size_t specialize_after = device.specialize_after;
+	device.specialize_after = 0;
+
+	cl::CommandQueue& queue = device.queue;
+	std::vector< cl_product_tuning<T> > tunings;
+
+	try {
+
+		// Operands and reference product of each shape
+		for ( const cl_product_shape& shape : shapes ){
+
+			const size_t M = shape.M, N = shape.N, K = shape.K;
+
+			cl_product_tuning<T> tuning;
+			tuning.shape = shape;
+			tuning.best.time_us = -1.0;
+			tuning.R = cl_matrix<T>(M, N);
+
+			cl_matrix<T> A(M, K), B(K, N);
+			A.fill_rand(1,10,10);
+			B.fill_rand(1,10,10);
+
+			tuning.buffer_A = device.get_buffer(CL_MEM_READ_ONLY,  sizeof(T)*M*K);
+			tuning.buffer_B = device.get_buffer(CL_MEM_READ_ONLY,  sizeof(T)*K*N);
+			tuning.buffer_C = device.get_buffer(CL_MEM_READ_WRITE, sizeof(T)*M*N);
+
+			queue.enqueueWriteBuffer(*tuning.buffer_A, CL_TRUE, 0, sizeof(T)*M*K, A.data.data());
+			queue.enqueueWriteBuffer(*tuning.buffer_B, CL_TRUE, 0, sizeof(T)*K*N, B.data.data());
+
+			cl_matrix<T>::product_enqueue(device, queue, "f32_product_v0", cl::NDRange(8,8), M, N, K, 
+				*tuning.buffer_A, *tuning.buffer_B, *tuning.buffer_C);
+			queue.enqueueReadBuffer(*tuning.buffer_C, CL_TRUE, 0, sizeof(T)*M*N, &tuning.R.data[0]);
+
+			tunings.push_back( tuning );
+		}
+
+		for ( const cl_product_trial& trial : trials ){
+
+			// Build variant (program of its own)
+			std::string launch_name = trial.launch->kernel_name;
+			if ( !trial.candidate.config.empty() ){
+
+				try {
+					launch_name = device.get_variant( trial.launch->kernel_name, trial.candidate.config, false );
+				}
+				catch (cl_build_error& e) {
+					if ( pprint ){
+						printf("\t| %s\t build failed (skipped)\n", trial.launch->kernel_name);
+					}
+					continue;
+				}
+			}
+
+			for ( cl_product_tuning<T>& tuning : tunings ){
+
+				const size_t M = tuning.shape.M, N = tuning.shape.N, K = tuning.shape.K;
+
+				// Skip launches which the device cannot run
+				cl_product_config config = trial.launch->configure(
+					device, launch_name.c_str(), trial.candidate.NDR, M, N, K, sizeof(T) );
+
+				if ( !cl_product_fits(device, config) ){
+					continue;
+				}
+
+				try {
+
+					// Warm up run (verified)
+					cl_matrix<T> C(M, N);
+					cl_matrix<T>::product_enqueue(
+						device, queue, trial.launch->kernel_name, trial.candidate.NDR, M, N, K, 
+						*tuning.buffer_A, *tuning.buffer_B, *tuning.buffer_C, (T)1, (T)0, launch_name.c_str() );
+					queue.enqueueReadBuffer(*tuning.buffer_C, CL_TRUE, 0, sizeof(T)*M*N, &C.data[0]);
+
+					bool valid = true;
+					for ( size_t i = 0; i < M*N && valid; i++ ){
+						valid = ( std::fabs( C.data[i] - tuning.R.data[i] ) <= 1e-3 * std::max( (T)1, std::fabs( tuning.R.data[i] ) ) );
+					}
+					if ( !valid ){
+						if ( pprint ){
+							printf("\t| %s\t M=%d N=%d K=%d\t invalid result (skipped)\n", 
+								launch_name.c_str(), (int)M, (int)N, (int)K);
+						}
+						continue;
+					}
+
+					// Timed runs
+					std::chrono::time_point<std::chrono::steady_clock> t0 = std::chrono::steady_clock::now();
+					for ( size_t c = 0; c < cycles; c++ ){
+						cl_matrix<T>::product_enqueue(
+							device, queue, trial.launch->kernel_name, trial.candidate.NDR, M, N, K, 
+							*tuning.buffer_A, *tuning.buffer_B, *tuning.buffer_C, (T)1, (T)0, launch_name.c_str() );
+					}
+					queue.finish();
+
+					std::chrono::duration<double, std::micro> dt = std::chrono::steady_clock::now() - t0;
+					const double time_us = dt.count() / (double)std::max( cycles, (size_t)1 );
+
+					if ( pprint ){
+						printf("\t| %s\t M=%d N=%d K=%d\t %fus\n", launch_name.c_str(), (int)M, (int)N, (int)K, time_us);
+					}
+
+					cl_tuning_entry& best = tuning.best;
+					if ( best.time_us < 0.0 || time_us < best.time_us ){
+						best.kernel_name = trial.launch->kernel_name;
+						best.config = trial.candidate.config;
+						best.local.clear();
+						for ( size_t d = 0; d < trial.candidate.NDR.dimensions(); d++ ){
+							best.local.push_back( trial.candidate.NDR[d] );
+						}
+						best.time_us = time_us;
+					}
+				}
+
+				// Launch failed (e.g. out of resources)
+				catch (cl::Error& e) {
+					if ( pprint ){
+						printf("\t| %s\t %s (skipped)\n", launch_name.c_str(), device.get_error_string( e.err() ));
+					}
+					queue.finish();
+				}
+			}
+		}
+	}
+
+	catch (cl::Error& e) {
+		printf("Runtime Error(%d): %s\n", e.err(), device.get_error_string( e.err() ) );
+		printf("  what(): %s\n", e.what() );
+		exit(1);
+	}
+
+	size_t tuned = 0;
+	for ( const cl_product_tuning<T>& tuning : tunings ){
+
+		if ( tuning.best.time_us < 0.0 ){
+			continue;
+		}
+
+		const cl_product_shape& shape = tuning.shape;
+		const std::string bucket = cl_tuning_db::bucket(shape.M, shape.N, shape.K, sizeof(T));
+		device.tuning.update( bucket, tuning.best );
+		tuned++;
+
+		if ( pprint ){
+			printf("M=%d N=%d K=%d\t| %s\t best: %s (%fus)\n", 
+				(int)shape.M, (int)shape.N, (int)shape.K, bucket.c_str(), tuning.best.kernel_name.c_str(), tuning.best.time_us);
+		}
+	}
+
+	device.specialize_after = specialize_after;
+	return tuned;
+}
@@ -0,0 +1,496 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> inc/extensions/cl_dispatch.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+//
+// AuroraCL product kernel dispatch table
+//
+// Each product kernel (kernels/f32/cl_product_f32.cl) is described by a launch 
+// descriptor: how its NDRange follows from the problem (and the PKP tile 
+// constants), which __local buffers it needs, which shapes it accepts and a 
+// nominal throughput weight. All product kernels share one argument layout:
+//
+//	0-2: M, N, K
+//	3-5: A, B, C
+//	6-8: ALPHA, BETA, BIAS
+//	9- : __local buffers (cl_product_config::local_args)
+//
+// Split-K kernels (cl_product_config::splits) instead take a scratch buffer, 
+// the number of splits and the pass (9-11), and are launched twice.
+//
+// cl_product_select() scores every eligible kernel which is loaded on the 
+// device and returns the best one, so product(B, device) needs no kernel name.
+// Launches found by the autotuner (extensions/cl_autotune.cpp) take precedence
+// for shapes which have been tuned on the device.
+//
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+// Round x up to a multiple of b (global NDRange for partial tiles)
+inline size_t cl_round_up(size_t x, size_t b){ return ( ( x + b - 1 ) / b ) * b; }
+
+// Split-K selection: products whose tiles number fewer than compute units times
+// CL_SPLIT_K_GROUPS use f32_product_v8, with K split so that this many 
+// workgroups run. Each split sums at least CL_SPLIT_K_MIN_DEPTH elements of K 
+// and there are at most CL_SPLIT_K_MAX splits (partial tiles in scratch).
+#define CL_SPLIT_K_GROUPS 4
+#define CL_SPLIT_K_MIN_DEPTH 256
+#define CL_SPLIT_K_MAX 64
+
+// Bind epilogue bias (a NULL buffer argument when there is none)
+inline void cl_set_bias_arg(cl::Kernel& kernel, cl_uint index, cl::Buffer* buffer_bias){
+	if ( buffer_bias ){
+		kernel.setArg(index, *buffer_bias);
+	}
+	else {
+		kernel.setArg(index, sizeof(cl_mem), NULL);
+	}
+}
+
+// Launch configuration of a product kernel for one problem
+struct cl_product_config {
+	cl::NDRange global;				// global range (rounded to workgroups)
+	cl::NDRange local;				// workgroup shape
+	std::vector<size_t> local_args;	// __local arguments (bytes)
+	size_t local_bytes;				// total __local memory (arguments and static)
+	size_t covered;					// elements of C computed (including padding)
+	size_t splits = 0;				// splits of K (split-K kernels only)
+};
+
+// Check that a launch fits the device (workgroup size and __local memory)
+inline bool cl_product_fits(const cl_device& device, const cl_product_config& config){
+
+	size_t work_group_size = 1;
+	for ( size_t d = 0; d < config.local.dimensions(); d++ ){
+		work_group_size *= config.local[d];
+	}
+
+	if ( device.max_work_group_size != 0 && work_group_size > device.max_work_group_size ){
+		return false;
+	}
+	return ( device.local_mem_size == 0 || config.local_bytes <= device.local_mem_size );
+}
+
+// Tuning candidate: PKP values of a kernel variant and the caller's workgroup
+// shape (NullRange for kernels which do not take one)
+struct cl_product_candidate {
+	std::map<std::string, std::string> config;
+	cl::NDRange NDR;
+};
+
+// Launch descriptor
+struct cl_product_launch {
+
+	// Kernel name
+	const char* kernel_name;
+
+	// NDRange transform and __local sizing. launch_name may be a variant of 
+	// kernel_name (PKP values are read from it) and NDR is the caller's range.
+	cl_product_config (*configure)(
+		cl_device& device, const char* launch_name, cl::NDRange NDR, 
+		size_t M, size_t N, size_t K, size_t m_size_t );
+
+	// Shape constraint (NULL if any shape is accepted)
+	bool (*eligible)(cl_device& device, const char* kernel_name, size_t M, size_t N, size_t K);
+
+	// Nominal throughput on large problems (relative to f32_product_v0)
+	double weight;
+
+	// buffer_B holds B^T (packed operand)
+	bool packed_B;
+
+	// Workgroup shape is taken from the caller's NDR (not selected automatically)
+	bool uses_NDR;
+
+	// Tuning search space (valid PKP values and workgroup shapes)
+	std::vector<cl_product_candidate> (*candidates)(cl_device& device, const char* kernel_name);
+};
+
+// Read PKP constant of kernel as integer (values which are not are reported)
+inline size_t cl_pkp_size(cl_device& device, const char* kernel_name, const char* constant){
+
+	const std::string value = device.get_config(kernel_name, constant);
+	if ( value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos ){
+		printf("PKP Error:\n\t(config) Value (%s) of key (%s) in kernel (%s) is not a size\n", 
+			value.c_str(), constant, kernel_name );
+		exit(1);
+	}
+	return (size_t)std::stoul( value );
+}
+
+// Kernel v0: global range rounded to workgroups (NullRange lets the runtime choose)
+inline cl_product_config cl_configure_v0(
+	cl_device& device, const char* launch_name, cl::NDRange NDR, size_t M, size_t N, size_t K, size_t m_size_t ){
+
+	cl_product_config config;
+	config.global = ( NDR.dimensions() == 0 ) ? 
+		cl::NDRange( M, N ) : cl::NDRange( cl_round_up(M, NDR[0]), cl_round_up(N, NDR[1]) );
+	config.local = NDR;
+	config.local_bytes = 0;
+	config.covered = config.global[0] * config.global[1];
+	return config;
+}
+
+// Kernel v1: __local tiles of the workgroup shape
+inline cl_product_config cl_configure_v1(
+	cl_device& device, const char* launch_name, cl::NDRange NDR, size_t M, size_t N, size_t K, size_t m_size_t ){
+
+	cl_product_config config;
+	config.global = cl::NDRange( cl_round_up(M, NDR[0]), cl_round_up(N, NDR[1]) );
+	config.local = NDR;
+	config.local_args.assign( 2, NDR[0]*NDR[1]*m_size_t );
+	config.local_bytes = 2*NDR[0]*NDR[1]*m_size_t;
+	config.covered = config.global[0] * config.global[1];
+	return config;
+}
+
+// Kernel v2: NDR[1] columns of C per thread (1D register tiling)
+inline cl_product_config cl_configure_v2(
+	cl_device& device, const char* launch_name, cl::NDRange NDR, size_t M, size_t N, size_t K, size_t m_size_t ){
+
+	const size_t wptN = NDR[1];
+
+	cl_product_config config;
+	config.local = cl::NDRange( NDR[0], NDR[1] / wptN );
+	config.global = cl::NDRange( cl_round_up(M, config.local[0]), cl_round_up( ( N + wptN - 1 ) / wptN, config.local[1] ) );
+	config.local_args.assign( 2, NDR[0]*NDR[1]*m_size_t );
+	config.local_bytes = 2*NDR[0]*NDR[1]*m_size_t;
+	config.covered = config.global[0] * config.global[1] * wptN;
+	return config;
+}
+
+// Kernels v3-v6: 2D register tiling. Tile sizes and work per thread are compile 
+// time constants (PKP) and the workgroup shape follows from these (NDR is not 
+// used). Tiles are static __local arrays (PIPELINE_DEPTH copies for v6).
+inline cl_product_config cl_configure_tiled(
+	cl_device& device, const char* launch_name, cl::NDRange NDR, size_t M, size_t N, size_t K, size_t m_size_t ){
+
+	const size_t tsM  = cl_pkp_size(device, launch_name, "TILE_SIZE_M");
+	const size_t tsN  = cl_pkp_size(device, launch_name, "TILE_SIZE_N");
+	const size_t tsK  = cl_pkp_size(device, launch_name, "TILE_SIZE_K");
+	const size_t wptM = cl_pkp_size(device, launch_name, "WORK_PER_THREAD_M");
+	const size_t wptN = cl_pkp_size(device, launch_name, "WORK_PER_THREAD_N");
+
+	// Pipelined kernels hold several tiles
+	const std::map<std::string, std::string> pkp = device.get_config(launch_name);
+	const size_t depth = ( pkp.find("PIPELINE_DEPTH") != pkp.end() ) ?
+		cl_pkp_size(device, launch_name, "PIPELINE_DEPTH") : 1;
+
+	// Vectorized kernels. Vectors crossing the edge of a matrix are handled
+	// element by element, and vloadn only requires element alignment.
+	if ( pkp.find("VECTOR_WIDTH") != pkp.end() ){
+
+		const size_t vw = cl_pkp_size(device, launch_name, "VECTOR_WIDTH");
+		if ( vw != 2 && vw != 4 && vw != 8 ){
+			printf("Kernel Error: Vector width (%d) must be 2, 4 or 8\n", (int)vw);
+			exit(1);
+		}
+	}
+
+	cl_product_config config;
+	config.global = cl::NDRange( cl_round_up(M, tsM) / wptM, cl_round_up(N, tsN) / wptN );
+	config.local = cl::NDRange( tsM / wptM, tsN / wptN );
+	config.local_bytes = depth * tsK * ( tsM + tsN ) * m_size_t;
+	config.covered = cl_round_up(M, tsM) * cl_round_up(N, tsN);
+	return config;
+}
+
+// Kernel v7: 2D register tiling with padded __local tiles sized by the host
+inline cl_product_config cl_configure_v7(
+	cl_device& device, const char* launch_name, cl::NDRange NDR, size_t M, size_t N, size_t K, size_t m_size_t ){
+
+	cl_product_config config = cl_configure_tiled(device, launch_name, NDR, M, N, K, m_size_t);
+
+	const size_t tsM  = cl_pkp_size(device, launch_name, "TILE_SIZE_M");
+	const size_t tsN  = cl_pkp_size(device, launch_name, "TILE_SIZE_N");
+	const size_t tsK  = cl_pkp_size(device, launch_name, "TILE_SIZE_K");
+	const size_t pad  = cl_pkp_size(device, launch_name, "LOCAL_PAD");
+
+	config.local_args.push_back( tsK * ( tsM + pad ) * m_size_t );
+	config.local_args.push_back( tsK * ( tsN + pad ) * m_size_t );
+	config.local_bytes = config.local_args[0] + config.local_args[1];
+	return config;
+}
+
+// Number of splits of K for tiles of C (see CL_SPLIT_K_GROUPS)
+inline size_t cl_split_k(cl_device& device, size_t tiles, size_t K){
+
+	const size_t groups = std::max( device.compute_units, (size_t)1 ) * CL_SPLIT_K_GROUPS;
+	const size_t splits = ( groups + tiles - 1 ) / std::max( tiles, (size_t)1 );
+	return std::max( std::min( { splits, K / CL_SPLIT_K_MIN_DEPTH, (size_t)CL_SPLIT_K_MAX } ), (size_t)1 );
+}
+
+// Kernel v8: TILE_SIZE x TILE_SIZE tiles of C (dimensions 0 and 1 along N and M)
+// for each split of K (dimension 2)
+inline cl_product_config cl_configure_v8(
+	cl_device& device, const char* launch_name, cl::NDRange NDR, size_t M, size_t N, size_t K, size_t m_size_t ){
+
+	const size_t ts = cl_pkp_size(device, launch_name, "TILE_SIZE");
+	const size_t tiles = ( cl_round_up(M, ts) / ts ) * ( cl_round_up(N, ts) / ts );
+
+	cl_product_config config;
+	config.splits = cl_split_k(device, tiles, K);
+	config.global = cl::NDRange( cl_round_up(N, ts), cl_round_up(M, ts), config.splits );
+	config.local = cl::NDRange( ts, ts, 1 );
+	config.local_bytes = 2*ts*ts*m_size_t;
+	config.covered = cl_round_up(M, ts) * cl_round_up(N, ts);
+	return config;
+}
+
+// Kernel v8 is only worthwhile when the tiles of C leave compute units idle and 
+// K is deep enough to split (and its workgroup must fit the device)
+inline bool cl_eligible_v8(cl_device& device, const char* kernel_name, size_t M, size_t N, size_t K){
+
+	const size_t ts = cl_pkp_size(device, kernel_name, "TILE_SIZE");
+	const size_t tiles = ( cl_round_up(M, ts) / ts ) * ( cl_round_up(N, ts) / ts );
+	const size_t compute_units = std::max( device.compute_units, (size_t)1 );
+
+	if ( device.max_work_group_size != 0 && ts*ts > device.max_work_group_size ){
+		return false;
+	}
+	return ( tiles < compute_units*CL_SPLIT_K_GROUPS && cl_split_k(device, tiles, K) > 1 );
+}
+
+// Tuning candidate from PKP values and workgroup shape
+inline cl_product_candidate cl_candidate(std::map<std::string, std::string> config, cl::NDRange NDR){
+	cl_product_candidate candidate;
+	candidate.config = config;
+	candidate.NDR = NDR;
+	return candidate;
+}
+
+// Kernel v0: workgroup shapes
+inline std::vector<cl_product_candidate> cl_candidates_v0(cl_device& device, const char* kernel_name){
+
+	std::vector<cl_product_candidate> candidates;
+	for ( cl::NDRange NDR : { 
+		cl::NDRange(4,4), cl::NDRange(8,8), cl::NDRange(16,16), cl::NDRange(32,8), 
+		cl::NDRange(8,32), cl::NDRange(64,4), cl::NDRange(16,4) } ){
+		candidates.push_back( cl_candidate( {}, NDR ) );
+	}
+	return candidates;
+}
+
+// Kernel v1: square workgroups (tile size)
+inline std::vector<cl_product_candidate> cl_candidates_v1(cl_device& device, const char* kernel_name){
+
+	std::vector<cl_product_candidate> candidates;
+	for ( size_t b : { 4, 8, 16 } ){
+		candidates.push_back( cl_candidate( {}, cl::NDRange(b, b) ) );
+	}
+	return candidates;
+}
+
+// Kernel v2: square workgroups with matching work per thread
+inline std::vector<cl_product_candidate> cl_candidates_v2(cl_device& device, const char* kernel_name){
+
+	std::vector<cl_product_candidate> candidates;
+	for ( size_t b : { 4, 8, 16 } ){
+		candidates.push_back( cl_candidate( { { "WORK_PER_THREAD_N", std::to_string(b) } }, cl::NDRange(b, b) ) );
+	}
+	return candidates;
+}
+
+// Kernels v3-v7: tile sizes and work per thread (and the vector width, pipeline
+// depth or padding where the kernel has one). Only combinations which satisfy
+// the #error checks of the kernels, and whose (f32) tiles fit the __local 
+// memory of the device, are generated.
+inline std::vector<cl_product_candidate> cl_candidates_tiled(cl_device& device, const char* kernel_name){
+
+	const std::map<std::string, std::string> pkp = device.get_config(kernel_name);
+	const bool has_vw    = ( pkp.find("VECTOR_WIDTH")   != pkp.end() );
+	const bool has_depth = ( pkp.find("PIPELINE_DEPTH") != pkp.end() );
+	const bool has_pad   = ( pkp.find("LOCAL_PAD")      != pkp.end() );
+
+	std::vector<cl_product_candidate> candidates;
+	for ( size_t ts : { 32, 64, 128 } )
+	for ( size_t tsK : { 8, 16, 32 } )
+	for ( size_t wptM : { 4, 8 } )
+	for ( size_t wptN : { 4, 8 } )
+	for ( size_t vw : has_vw ? std::vector<size_t>{ 2, 4, 8 } : std::vector<size_t>{ 1 } )
+	for ( size_t extra : has_depth ? std::vector<size_t>{ 2, 3 } : has_pad ? std::vector<size_t>{ 0, 1 } : std::vector<size_t>{ 0 } ){
+
+		// Tile loads must divide evenly over the workgroup (in vectors)
+		const size_t threads = ( ts / wptM ) * ( ts / wptN );
+		if ( ( tsK % vw ) || ( wptN % vw ) || ( ( ts * tsK / vw ) % threads ) ){
+			continue;
+		}
+
+		// Tiles of A and B (PIPELINE_DEPTH copies or padded rows)
+		const size_t depth = has_depth ? extra : 1;
+		const size_t pad = has_pad ? extra : 0;
+		if ( device.local_mem_size != 0 && depth * tsK * 2 * ( ts + pad ) * sizeof(float) > device.local_mem_size ){
+			continue;
+		}
+
+		std::map<std::string, std::string> config = {
+			{ "TILE_SIZE_M", std::to_string(ts) },
+			{ "TILE_SIZE_N", std::to_string(ts) },
+			{ "TILE_SIZE_K", std::to_string(tsK) },
+			{ "WORK_PER_THREAD_M", std::to_string(wptM) },
+			{ "WORK_PER_THREAD_N", std::to_string(wptN) }
+		};
+		if ( has_vw )   { config[ "VECTOR_WIDTH" ]   = std::to_string(vw); }
+		if ( has_depth ){ config[ "PIPELINE_DEPTH" ] = std::to_string(extra); }
+		if ( has_pad )  { config[ "LOCAL_PAD" ]      = std::to_string(extra); }
+
+		candidates.push_back( cl_candidate( config, cl::NullRange ) );
+	}
+	return candidates;
+}
+
+// Kernel v8: tile sizes (splits of K follow from the compute units)
+inline std::vector<cl_product_candidate> cl_candidates_v8(cl_device& device, const char* kernel_name){
+
+	std::vector<cl_product_candidate> candidates;
+	for ( size_t ts : { 8, 16, 32 } ){
+		candidates.push_back( cl_candidate( { { "TILE_SIZE", std::to_string(ts) } }, cl::NullRange ) );
+	}
+	return candidates;
+}
+
+// Registry of product kernels. Entries may be appended for additional kernels 
+// which follow the shared argument layout.
+inline std::vector<cl_product_launch>& cl_product_registry(void){
+
+	static std::vector<cl_product_launch> registry = {
+		// kernel_name        configure           eligible        weight packed uses_NDR candidates
+		{ "f32_product_v0", cl_configure_v0,    NULL,           1.0,   false, false,   cl_candidates_v0    },
+		{ "f32_product_v1", cl_configure_v1,    NULL,           2.0,   false, true,    cl_candidates_v1    },
+		{ "f32_product_v2", cl_configure_v2,    NULL,           3.0,   false, true,    cl_candidates_v2    },
+		{ "f32_product_v3", cl_configure_tiled, NULL,           4.0,   false, false,   cl_candidates_tiled },
+		{ "f32_product_v4", cl_configure_tiled, NULL,           6.0,   false, false,   cl_candidates_tiled },
+		{ "f32_product_v5", cl_configure_tiled, NULL,           6.0,   true,  false,   cl_candidates_tiled },
+		{ "f32_product_v6", cl_configure_tiled, NULL,           5.0,   false, false,   cl_candidates_tiled },
+		{ "f32_product_v7", cl_configure_v7,    NULL,           5.0,   false, false,   cl_candidates_tiled },
+		{ "f32_product_v8", cl_configure_v8,    cl_eligible_v8, 2.0,   false, false,   cl_candidates_v8    }
+	};
+	return registry;
+}
+
+// Find launch descriptor (NULL if kernel_name is not a product kernel)
+inline const cl_product_launch* cl_product_find(const char* kernel_name){
+
+	for ( const cl_product_launch& launch : cl_product_registry() ){
+		if ( strcmp( launch.kernel_name, kernel_name ) == 0 ){
+			return &launch;
+		}
+	}
+	return NULL;
+}
+
+// Find launch descriptor of a kernel or of a variant of one (see cl_pkp::add_variant)
+inline const cl_product_launch* cl_product_find(cl_device& device, const char* kernel_name){
+	return cl_product_find( device.get_base(kernel_name).c_str() );
+}
+
+// Tuned launch for A(M,K)*B(K,N) on device (NULL if the shape bucket has not been
+// tuned or the entry does not apply to the loaded kernels)
+inline const cl_tuning_entry* cl_product_tuned(cl_device& device, size_t M, size_t N, size_t K, size_t m_size_t){
+
+	const cl_tuning_entry* tuned = device.tuning.find( cl_tuning_db::bucket(M, N, K, m_size_t) );
+	if ( tuned == NULL || cl_product_find( tuned->kernel_name.c_str() ) == NULL ){
+		return NULL;
+	}
+
+	// Entries may outlive changes to the kernel sources
+	if ( !device.has_kernel( tuned->kernel_name ) ){
+		return NULL;
+	}
+	const std::map<std::string, std::string> pkp = device.get_config( tuned->kernel_name );
+	for ( auto c = tuned->config.cbegin(); c != tuned->config.cend(); ++c ){
+		if ( pkp.find( c->first ) == pkp.end() ){
+			return NULL;
+		}
+	}
+	return tuned;
+}
+
+// Select product kernel for A(M,K)*B(K,N) on device. If the shape bucket has 
+// been tuned then the tuned kernel (a variant if it has PKP values) is returned 
+// and its workgroup shape, if any, is written to NDR. Otherwise every loaded 
+// kernel which accepts the shape and fits in __local memory is scored as 
+//
+//	weight * ( M*N / covered ) * min( 1, workgroups / compute units )
+//
+// i.e. its nominal throughput discounted by work wasted on padded tiles and by 
+// idle compute units. Kernels which take a packed B or the caller's workgroup 
+// shape are only used when named explicitly.
+inline std::string cl_product_select(cl_device& device, size_t M, size_t N, size_t K, size_t m_size_t, cl::NDRange* NDR = NULL){
+
+	// Tuned launch (kernels taking the caller's shape need it returned)
+	const cl_tuning_entry* tuned = cl_product_tuned(device, M, N, K, m_size_t);
+	if ( tuned && ( NDR != NULL || !cl_product_find( tuned->kernel_name.c_str() )->uses_NDR ) ){
+
+		if ( NDR != NULL && tuned->local.size() == 2 ){
+			*NDR = cl::NDRange( tuned->local[0], tuned->local[1] );
+		}
+
+		// Variant built into a program of its own (see cl_device::get_variant)
+		return tuned->config.empty() ? 
+			tuned->kernel_name : device.get_variant( tuned->kernel_name, tuned->config );
+	}
+
+	const char* best_name = "f32_product_v0";
+	double best_score = -1.0;
+
+	const double compute_units = (double)std::max( device.compute_units, (size_t)1 );
+
+	for ( const cl_product_launch& launch : cl_product_registry() ){
+
+		if ( launch.packed_B || launch.uses_NDR ||
+			 !device.has_kernel( launch.kernel_name ) ){
+			continue;
+		}
+		if ( launch.eligible && !launch.eligible(device, launch.kernel_name, M, N, K) ){
+			continue;
+		}
+
+		cl_product_config config = launch.configure(device, launch.kernel_name, cl::NDRange(8,8), M, N, K, m_size_t);
+		if ( !cl_product_fits(device, config) ){
+			continue;
+		}
+
+		double workgroups = 1.0;
+		for ( size_t d = 0; d < config.global.dimensions(); d++ ){
+			workgroups *= (double)( config.global[d] / config.local[d] );
+		}
+		const double score = launch.weight 
+			* (double)( M*N ) / (double)std::max( config.covered, (size_t)1 )
+			* std::min( 1.0, workgroups / compute_units );
+
+		if ( score > best_score ){
+			best_score = score;
+			best_name = launch.kernel_name;
+		}
+	}
+	return std::string( best_name );
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> inc/extensions/cl_epilogue.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+//
+// AuroraCL product epilogues
+//
+// An epilogue is applied to each element of C in registers before it is stored
+// by the product kernel, so that inference style layers run as one kernel:
+//
+//	C = activation( scale * A * B + bias )
+//
+// The bias is a row vector (one value per column of C). The descriptor is 
+// translated into the PKP constant EPILOGUE of the product kernels (an
+// expression in VAL and COL) and a specialized kernel variant is built once for 
+// each distinct expression (cl_device::get_variant).
+//
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+// Activation functions
+enum cl_activation {
+	CL_ACTIVATION_NONE,
+	CL_ACTIVATION_RELU,
+	CL_ACTIVATION_CLAMP,
+	CL_ACTIVATION_TANH
+};
+
+// Epilogue descriptor
+template<class T>
+class cl_epilogue {
+
+	public:
+
+		std::vector<T> bias;		// bias row (empty for none)
+		T scale;					// scale of the product (alpha)
+		cl_activation activation;	// activation function
+		T clamp_min;				// bounds for CL_ACTIVATION_CLAMP
+		T clamp_max;
+
+		// Constructors
+		cl_epilogue(void);
+		explicit cl_epilogue(cl_activation activation, const std::vector<T>& bias = std::vector<T>(), T scale = 1);
+
+		// Clamp activation with bounds
+		static cl_epilogue<T> clamp(T clamp_min, T clamp_max, const std::vector<T>& bias = std::vector<T>(), T scale = 1);
+
+		// PKP expression for EPILOGUE (VAL if identity)
+		std::string expression(void) const;
+};
+
+// Constructor (identity)
+template<class T>
+cl_epilogue<T>::cl_epilogue(void) : scale(1), activation(CL_ACTIVATION_NONE), clamp_min(0), clamp_max(0) {}
+
+// Constructor
+template<class T>
+cl_epilogue<T>::cl_epilogue(cl_activation activation, const std::vector<T>& bias, T scale) : 
+	bias(bias), scale(scale), activation(activation), clamp_min(0), clamp_max(0) {}
+
+// Clamp activation with bounds
+template<class T>
+cl_epilogue<T> cl_epilogue<T>::clamp(T clamp_min, T clamp_max, const std::vector<T>& bias, T scale){
+	cl_epilogue<T> E(CL_ACTIVATION_CLAMP, bias, scale);
+	E.clamp_min = clamp_min;
+	E.clamp_max = clamp_max;
+	return E;
+}
+
+// PKP expression for EPILOGUE. Constants are written in full precision.
+template<class T>
+std::string cl_epilogue<T>::expression(void) const {
+
+	std::string e = this->bias.empty() ? "VAL" : "( VAL + BIAS[ COL ] )";
+
+	switch ( this->activation ){
+
+		case CL_ACTIVATION_RELU:
+			return "fmax( " + e + ", 0.0f )";
+
+		case CL_ACTIVATION_CLAMP: {
+			char buffer[96];
+			std::snprintf(buffer, sizeof(buffer), ", (float)(%.9g), (float)(%.9g) )", (double)this->clamp_min, (double)this->clamp_max);
+			return "clamp( " + e + std::string(buffer);
+		}
+
+		case CL_ACTIVATION_TANH:
+			return "tanh( " + e + " )";
+
+		default:
+			return e;
+	}
+}
\ No newline at end of file
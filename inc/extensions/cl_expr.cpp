@@ -0,0 +1,153 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> inc/extensions/cl_expr.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+//
+// AuroraCL elementwise expression templates
+//
+// Elementwise operations on cl_matrix (+, -, dot and scalar *) return light
+// weight expression nodes rather than matrices. A chain such as
+//
+//	cl_matrix<float> D = A + B - C * 2.0f;
+//
+// builds a tree of nodes which is evaluated in a single loop when assigned to a
+// cl_matrix (no temporaries, one pass over memory). Matrices are held in nodes
+// by reference and nodes by value, so expressions should be assigned within the
+// statement that creates them (do not store them with auto).
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+
+// Forward declarations of matrix type (leaf node) and binary node
+template<class T, class Alloc> class cl_matrix;
+template<class L, class R, class Op, class T> class cl_expr_binary;
+
+// Nodes hold matrices by reference and expressions by value
+template<class E> struct cl_expr_ref { typedef const E type; };
+template<class T, class Alloc> struct cl_expr_ref< cl_matrix<T, Alloc> > { typedef const cl_matrix<T, Alloc>& type; };
+
+// Elementwise operations
+struct cl_op_add { template<class T> static T apply(T a, T b){ return a + b; } };
+struct cl_op_sub { template<class T> static T apply(T a, T b){ return a - b; } };
+struct cl_op_mul { template<class T> static T apply(T a, T b){ return a * b; } };
+
+// Check that operands have the same shape
+template<class L, class R>
+inline void cl_expr_check(const L& l, const R& r){
+
+	if ( l.m != r.m || l.n != r.n ){
+		printf(
+			"Unable to broadcast shapes %d(rows) x %d(cols) and %d(rows) x %d(cols)\n",
+			(int)l.m,
+			(int)l.n,
+			(int)r.m,
+			(int)r.n
+		);
+		exit(1);
+	}
+}
+
+// Expression base class (CRTP). E is the node type and T the element type.
+template<class E, class T>
+class cl_expr {
+
+	public:
+
+		// Downcast to node type
+		const E& self(void) const { return static_cast<const E&>(*this); }
+
+		// Node dimensions and element access (linear index)
+		size_t rows(void) const { return this->self().m; }
+		size_t cols(void) const { return this->self().n; }
+		T eval(size_t i) const { return this->self().eval(i); }
+
+		// Elementwise multiplication
+		template<class R>
+		cl_expr_binary<E, R, cl_op_mul, T> dot(const cl_expr<R, T>& A) const {
+			return cl_expr_binary<E, R, cl_op_mul, T>( this->self(), A.self() );
+		}
+};
+
+// Binary node: Op(L, R)
+template<class L, class R, class Op, class T>
+class cl_expr_binary : public cl_expr< cl_expr_binary<L, R, Op, T>, T > {
+
+	public:
+
+		size_t m;	// m-rows
+		size_t n;	// n-cols
+
+		// Operands
+		typename cl_expr_ref<L>::type l;
+		typename cl_expr_ref<R>::type r;
+
+		// Constructor (check dimensions)
+		cl_expr_binary(const L& l, const R& r) : m(l.m), n(l.n), l(l), r(r) { cl_expr_check(l, r); }
+
+		// Evaluate element
+		T eval(size_t i) const { return Op::apply( this->l.eval(i), this->r.eval(i) ); }
+};
+
+// Scalar node: val * E
+template<class E, class T>
+class cl_expr_scalar : public cl_expr< cl_expr_scalar<E, T>, T > {
+
+	public:
+
+		size_t m;	// m-rows
+		size_t n;	// n-cols
+
+		// Operands
+		typename cl_expr_ref<E>::type e;
+		T val;
+
+		// Constructor
+		cl_expr_scalar(const E& e, T val) : m(e.m), n(e.n), e(e), val(val) {}
+
+		// Evaluate element
+		T eval(size_t i) const { return this->val * this->e.eval(i); }
+};
+
+// Operator overloads (+/-)
+template<class L, class R, class T>
+inline cl_expr_binary<L, R, cl_op_add, T> operator+(const cl_expr<L, T>& l, const cl_expr<R, T>& r){
+	return cl_expr_binary<L, R, cl_op_add, T>( l.self(), r.self() );
+}
+
+template<class L, class R, class T>
+inline cl_expr_binary<L, R, cl_op_sub, T> operator-(const cl_expr<L, T>& l, const cl_expr<R, T>& r){
+	return cl_expr_binary<L, R, cl_op_sub, T>( l.self(), r.self() );
+}
+
+// Scalar multiplication (lexers)
+// Would like 2*A and A*2 to behave as expected
+template<class E, class T> inline cl_expr_scalar<E, T> operator*( const cl_expr<E, T>& e, int val){ return cl_expr_scalar<E, T>( e.self(), (T)val ); }
+template<class E, class T> inline cl_expr_scalar<E, T> operator*( const cl_expr<E, T>& e, float val){ return cl_expr_scalar<E, T>( e.self(), (T)val ); }
+template<class E, class T> inline cl_expr_scalar<E, T> operator*( const cl_expr<E, T>& e, double val){ return cl_expr_scalar<E, T>( e.self(), (T)val ); }
+template<class E, class T> inline cl_expr_scalar<E, T> operator*( int val, const cl_expr<E, T>& e){ return cl_expr_scalar<E, T>( e.self(), (T)val ); }
+template<class E, class T> inline cl_expr_scalar<E, T> operator*( float val, const cl_expr<E, T>& e){ return cl_expr_scalar<E, T>( e.self(), (T)val ); }
+template<class E, class T> inline cl_expr_scalar<E, T> operator*( double val, const cl_expr<E, T>& e){ return cl_expr_scalar<E, T>( e.self(), (T)val ); }
\ No newline at end of file
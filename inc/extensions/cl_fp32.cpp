@@ -24,21 +24,19 @@
 //	SOFTWARE.
 //
 
-template<class T>
-void cl_matrix<T>::show_threads( 
-	cl_device device, cl::NDRange gNDR, cl::NDRange lNDR, cl::NDRange lWPT ){
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::show_threads( 
+	cl_device& device, cl::NDRange gNDR, cl::NDRange lNDR, cl::NDRange lWPT ) const {
 
-	// Cast this pointer as A
-	cl_matrix<T> A = *this;
+	// Reference this as A
+	const cl_matrix<T, Alloc>& A = *this;
 
 	// Try show_threads()
 	try {
 
-		// Retrieve Kernel
+		// Retrieve Kernel and device command queue
 		cl::Kernel kernel = device.get_kernel("f32_show_threads"); 
-
-		// Create command queue
-		cl::CommandQueue queue(device.context, device.device);
+		cl::CommandQueue& queue = device.queue;
 
 		// Set kernel args
 		kernel.setArg(0, (const int)A.m);
@@ -62,20 +60,84 @@ void cl_matrix<T>::show_threads(
 	}	
 }
 
-template<class T>
-cl_matrix<T> cl_matrix<T>::product(
-	cl_matrix<T> B, cl_device device, const char* kernel_name, cl::NDRange NDR ){
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix<T, Alloc>::product(
+	const cl_matrix<T, Alloc>& B, cl_device& device, const char* kernel_name, cl::NDRange NDR ) const {
+
+	cl_matrix<T, Alloc> C;
+	this->product_into(B, C, device, kernel_name, NDR);
+	return C;
+}
+
+template<class T, class Alloc>
+cl_matrix<T, Alloc> cl_matrix<T, Alloc>::product(
+	const cl_matrix<T, Alloc>& B, cl_device& device, const cl_epilogue<T>& epilogue, const char* kernel_name, cl::NDRange NDR ) const {
+
+	cl_matrix<T, Alloc> C;
+	C.gemm( (T)1, *this, B, (T)0, device, kernel_name, NDR, &epilogue );
+	return C;
+}
+
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::product_into(
+	const cl_matrix<T, Alloc>& B, cl_matrix<T, Alloc>& C, cl_device& device, const char* kernel_name, cl::NDRange NDR ) const {
+
+	C.gemm( (T)1, *this, B, (T)0, device, kernel_name, NDR );
+}
+
+// General matrix product: this = alpha*A*B + beta*this. The existing matrix is
+// uploaded and accumulated into by the product kernel (no separate host pass).
+// If beta is zero the existing values are not read and this is resized to fit.
+// An epilogue (optional) is applied to the result before the store and its 
+// scale multiplies alpha.
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::gemm(
+	T alpha, const cl_matrix<T, Alloc>& A, const cl_matrix<T, Alloc>& B, T beta, 
+	cl_device& device, const char* kernel_name, cl::NDRange NDR, const cl_epilogue<T>* epilogue ){
+
+	// Reference this as C
+	cl_matrix<T, Alloc>& C = *this;
+
+	// Select kernel by shape
+	std::string selected;
+	if ( kernel_name == NULL ){
+		selected = cl_matrix<T, Alloc>::product_select(device, A.m, B.n, A.n, &NDR);
+		kernel_name = selected.c_str();
+	}
+
+	// Result aliases an operand (buffers are written asynchronously)
+	if ( &C == &A || &C == &B ){
+		cl_matrix<T, Alloc> R = C;
+		R.gemm(alpha, A, B, beta, device, kernel_name, NDR, epilogue);
+		C = std::move(R);
+		return;
+	}
+
+	// Accumulation requires a result of matching shape
+	const bool accumulate = ( beta != (T)0 );
+	if ( accumulate && ( C.m != A.m || C.n != B.n ) ){
+		printf(
+			"Unable to broadcast product %d(rows) x %d(cols) into %d(rows) x %d(cols)\n",
+			(int)A.m,
+			(int)B.n,
+			(int)C.m,
+			(int)C.n
+		);
+		exit(1);
+	}
 
-	// Cast this pointer as A
-	cl_matrix<T> A = *this;
-	cl_int Error = 0;
+	// Result matrix (zeros on error)
+	if ( C.m != A.m || C.n != B.n ){
+		C = cl_matrix<T, Alloc>(A.m, B.n);
+	}
 	
 	// Check type equivalence
 	if ( strcmp( A.m_type_t, B.m_type_t) != 0 ){
 		std::cout<<"Buffer error: Conflicting types for matrices\n";
 		std::cout<<"matrix(A) = "<<A.m_type_t<<"\n";
 		std::cout<<"matrix(B) = "<<B.m_type_t<<"\n";
-		return cl_matrix<T>(A.m, B.n);
+		std::fill(C.data.begin(), C.data.end(), T(0));
+		return;
 	}
 
 	// Check dimensions
@@ -87,170 +149,214 @@ cl_matrix<T> cl_matrix<T>::product(
 			(int)B.m,
 			(int)B.n
 		);
-		return cl_matrix<T>(A.m, B.n);
+		std::fill(C.data.begin(), C.data.end(), T(0));
+		return;
 	}	
 
-	// Check tiling
-	// if ( ( (  A.m % NDR[0] != 0 ) || ( B.n % NDR[1] != 0 ) ) && 
-	// 	 ( strcmp( kernel_name, "f32_product_v1" ) == 0 ) ) {
-	// 	printf("Unalinged tiling (%d, %d) on output matrix %d(rows) x %d(cols)\n >> Returning zeros\n\n",
-	// 		(int)NDR[0], 
-	// 		(int)NDR[1],
-	// 		(int)A.m,
-	// 		(int)B.n
-	// 	);
-	// 	return cl_matrix<T>(A.m, B.n);
-	// }
-
-
-	// Exception handler for OpenCL calls
-	try {
+	// Kernels taking a packed B (v5) need an operand packed once on the device
+	const cl_product_launch* launch = cl_product_find(device, kernel_name);
+	if ( launch != NULL && launch->packed_B ){
+		printf("Layout error: Kernel (%s) requires a packed right operand (see cl_device_matrix::pack)\n", kernel_name);
+		exit(1);
+	}
 
-		// Create command queue
-		cl::CommandQueue queue(device.context, device.device);
+	// Result is read by the kernel when accumulating
+	const cl_mem_flags C_flags = accumulate ? CL_MEM_READ_WRITE : CL_MEM_WRITE_ONLY;
 
-		// Create buffer objects for result matrix
-		T *buffer = (T *)malloc(sizeof(B.m_size_t)*A.m*B.n);
+	// Kernel variant applying the epilogue
+	std::string variant_name = kernel_name;
+	const bool has_bias = ( epilogue && !epilogue->bias.empty() );
+	if ( epilogue ){
 
-		// Declare cl::Buffers for matrices
-		cl::Buffer buffer_A; 
-		cl::Buffer buffer_B; 
-		cl::Buffer buffer_C; 
+		if ( has_bias && epilogue->bias.size() != B.n ){
+			printf("Unable to broadcast bias(len=%d) into %d(cols)\n", (int)epilogue->bias.size(), (int)B.n);
+			exit(1);
+		}
+		alpha *= epilogue->scale;
+		variant_name = cl_matrix<T, Alloc>::product_variant(device, kernel_name, *epilogue);
+	}
 
-		// Allocate buffers. Implemented as pinned memory (zero copy)
-		buffer_A = cl::Buffer(device.context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR,  A.m_size_t*A.m*A.n, NULL, &Error);
-		buffer_B = cl::Buffer(device.context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR,  B.m_size_t*B.m*B.n, NULL, &Error);
-		buffer_C = cl::Buffer(device.context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, B.m_size_t*A.m*B.n, NULL, &Error);
+	// Exception handler for OpenCL calls
+	try {
 
-		// non-blocking write to buffers
-		queue.enqueueWriteBuffer(buffer_A, CL_FALSE, 0, A.m_size_t*A.m*A.n, &A.data[0]);
-		queue.enqueueWriteBuffer(buffer_B, CL_FALSE, 0, B.m_size_t*B.m*B.n, &B.data[0]);
+		// Device command queue
+		cl::CommandQueue& queue = device.queue;
 
-		// Each matrix multiplicataion kernel requires different configuration of the API.
-		// Kernel v0: Simple mmul w/global memory access (__global)  
-		if (  strcmp (kernel_name, "f32_product_v0" ) == 0  ){
+		// Zero-copy path (host unified memory). Buffers wrap the (aligned) 
+		// matrix storage directly and the result is synchronized by mapping.
+		if ( device.zero_copy ){
 
-			// Retrieve Kernel
-			cl::Kernel kernel = device.get_kernel(kernel_name); 
+			cl::Buffer buffer_A(device.context, CL_MEM_READ_ONLY  | CL_MEM_USE_HOST_PTR, A.m_size_t*A.m*A.n, (void*)A.data.data());
+			cl::Buffer buffer_B(device.context, CL_MEM_READ_ONLY  | CL_MEM_USE_HOST_PTR, B.m_size_t*B.m*B.n, (void*)B.data.data());
+			cl::Buffer buffer_C(device.context, C_flags | CL_MEM_USE_HOST_PTR, C.m_size_t*C.m*C.n, (void*)C.data.data());
 
-			// Set kernel args
-			kernel.setArg(0, (const int)A.m);
-			kernel.setArg(1, (const int)B.n);
-			kernel.setArg(2, (const int)A.n);
-			kernel.setArg(3, buffer_A);
-			kernel.setArg(4, buffer_B);
-			kernel.setArg(5, buffer_C);
+			cl::Buffer buffer_bias;
+			if ( has_bias ){
+				buffer_bias = cl::Buffer(device.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, C.m_size_t*B.n, (void*)epilogue->bias.data());
+			}
 
-			// Enqueue buffer write and kernel execute commands
-			queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(A.m, B.n), NDR);
+			// Enqueue the product kernel
+			cl_matrix<T, Alloc>::product_enqueue( 
+				device, queue, kernel_name, NDR, A.m, B.n, A.n, buffer_A, buffer_B, buffer_C, alpha, beta,
+				variant_name.c_str(), has_bias ? &buffer_bias : NULL );
 
-			// Blocking read of data into buffers
-			queue.enqueueReadBuffer(buffer_C, CL_TRUE, 0, A.m_size_t*A.m*B.n, buffer);
+			// Map result (blocking) to make it visible in C, then release mapping
+			void* ptr = queue.enqueueMapBuffer(buffer_C, CL_TRUE, CL_MAP_READ, 0, C.m_size_t*C.m*C.n);
+			queue.enqueueUnmapMemObject(buffer_C, ptr);
 			queue.finish();
+			return;
 		}
 
+		// Pooled staging buffers (CL_MEM_ALLOC_HOST_PTR) for discrete devices
+		std::shared_ptr<cl::Buffer> buffer_A = device.get_buffer(CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR,  A.m_size_t*A.m*A.n);
+		std::shared_ptr<cl::Buffer> buffer_B = device.get_buffer(CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR,  B.m_size_t*B.m*B.n);
+		std::shared_ptr<cl::Buffer> buffer_C = device.get_buffer(C_flags | CL_MEM_ALLOC_HOST_PTR, C.m_size_t*C.m*C.n);
 
-		// Kernel v1: mmul with local memory tiling (__local)
-		if (  strcmp (kernel_name, "f32_product_v1" ) == 0  ){
-
-			// Retrieve Kernel
-			cl::Kernel kernel = device.get_kernel(kernel_name); 
-
-			// Set kernel args
-			kernel.setArg(0, (const int)A.m);
-			kernel.setArg(1, (const int)B.n);
-			kernel.setArg(2, (const int)A.n);
-			kernel.setArg(3, buffer_A);
-			kernel.setArg(4, buffer_B);
-			kernel.setArg(5, buffer_C);
-		 	kernel.setArg(6, cl::Local( NDR[0]*NDR[1]*A.m_size_t ) );
-		 	kernel.setArg(7, cl::Local( NDR[0]*NDR[1]*A.m_size_t ) );
-
-			// Enqueue buffer write and kernel execute commands
-			queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(A.m, B.n), NDR);
+		// non-blocking write to buffers
+		queue.enqueueWriteBuffer(*buffer_A, CL_FALSE, 0, A.m_size_t*A.m*A.n, A.data.data());
+		queue.enqueueWriteBuffer(*buffer_B, CL_FALSE, 0, B.m_size_t*B.m*B.n, B.data.data());
+		if ( accumulate ){
+			queue.enqueueWriteBuffer(*buffer_C, CL_FALSE, 0, C.m_size_t*C.m*C.n, C.data.data());
+		}
 
-			// Blocking read of data into buffers
-			queue.enqueueReadBuffer(buffer_C, CL_TRUE, 0, A.m_size_t*A.m*B.n, buffer);
-			queue.finish();
+		std::shared_ptr<cl::Buffer> buffer_bias;
+		if ( has_bias ){
+			buffer_bias = device.get_buffer(CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, C.m_size_t*B.n);
+			queue.enqueueWriteBuffer(*buffer_bias, CL_FALSE, 0, C.m_size_t*B.n, epilogue->bias.data());
 		}
 
+		// Enqueue the product kernel
+		cl_matrix<T, Alloc>::product_enqueue( 
+			device, queue, kernel_name, NDR, A.m, B.n, A.n, *buffer_A, *buffer_B, *buffer_C, alpha, beta,
+			variant_name.c_str(), buffer_bias.get() );
 
-		// Kernel v2: mmul with 1D-thread reduction (__private)
-		if (  strcmp (kernel_name, "f32_product_v2" ) == 0  ){
+		// Blocking read of data into result matrix
+		queue.enqueueReadBuffer(*buffer_C, CL_TRUE, 0, C.m_size_t*C.m*C.n, &C.data[0]);
+		queue.finish();
+	}
 
-			// Define work per thread
-			const int wptN = NDR[1];
+	// If exception is thrown it will be caught here
+	catch (cl::Error& e) {
+		printf("Runtime Error(%d): %s\n", e.err(), device.get_error_string( e.err() ) );
+		printf("  what(): %s\n", e.what() );
+		exit(1);
+	}	
+}
 
-			// Calculate transformed NDRange(s) (__gloabl/__local)
-			cl::NDRange G_NDR( A.m, B.n / wptN );
-			cl::NDRange L_NDR( NDR[0], NDR[1] / wptN );
+// Select a product kernel for A(M,K)*B(K,N) from the tuning database or the 
+// dispatch table (see cl_product_select in extensions/cl_dispatch.cpp)
+template<class T, class Alloc>
+std::string cl_matrix<T, Alloc>::product_select(cl_device& device, size_t M, size_t N, size_t K, cl::NDRange* NDR){
+	return cl_product_select(device, M, N, K, sizeof(T), NDR);
+}
 
-			// Retrieve Kernel
-			cl::Kernel kernel = device.get_kernel(kernel_name); 
+// Kernel variant applying an epilogue. The EPILOGUE expression is baked into a 
+// copy of the kernel by the PKP, which is built once and then reused.
+template<class T, class Alloc>
+std::string cl_matrix<T, Alloc>::product_variant(cl_device& device, const char* kernel_name, const cl_epilogue<T>& epilogue){
 
-		 	// Set kernel args
-		 	kernel.setArg(0, (const int)A.m);
-		 	kernel.setArg(1, (const int)B.n);
-		 	kernel.setArg(2, (const int)A.n);
-		 	kernel.setArg(3, buffer_A);
-		 	kernel.setArg(4, buffer_B);
-		 	kernel.setArg(5, buffer_C);
-		  	kernel.setArg(6, cl::Local( NDR[0]*NDR[1]*A.m_size_t ) );
-		  	kernel.setArg(7, cl::Local( NDR[0]*NDR[1]*A.m_size_t ) );
-		  	
-			// Enqueue buffer write and kernel execute commands
-			queue.enqueueNDRangeKernel( kernel, cl::NullRange, G_NDR, L_NDR );
+	std::string expression = epilogue.expression();
+	if ( expression == "VAL" ){
+		return std::string(kernel_name);
+	}
 
-			// Blocking read of data into buffers
-			queue.enqueueReadBuffer(buffer_C, CL_TRUE, 0, A.m_size_t*A.m*B.n, buffer);
-			queue.finish();
-		}
+	std::map<std::string, std::string> config;
+	config[ "EPILOGUE" ] = expression;
+	return device.get_variant(kernel_name, config);
+}
 
+// Enqueue a product kernel on buffers which are already resident on the device. 
+// Used by both the host product() above and cl_device_matrix. Launch settings
+// come from the dispatch table (extensions/cl_dispatch.cpp), so adding a kernel
+// only takes a descriptor. M, N and K are the dimensions of A(M,K)*B(K,N).
+// Kernel f32_product_v5 expects buffer_B to hold B packed as B^T, N(rows) x K(cols).
+// Any M, N and K are valid: global ranges are rounded up to whole workgroups and
+// the kernels guard partial tiles. All kernels compute C = alpha*A*B + beta*C, 
+// and buffer_C is only read when beta is nonzero. If variant_name is given the 
+// launch uses that variant of kernel_name (see product_variant), and buffer_bias 
+// (N values) is bound for its epilogue.
+template<class T, class Alloc>
+void cl_matrix<T, Alloc>::product_enqueue(
+	cl_device& device, cl::CommandQueue& queue, const char* kernel_name, cl::NDRange NDR,
+	size_t M, size_t N, size_t K, cl::Buffer& buffer_A, cl::Buffer& buffer_B, cl::Buffer& buffer_C, T alpha, T beta,
+	const char* variant_name, cl::Buffer* buffer_bias ){
+
+	// Size of type <T> for __local allocations
+	size_t m_size_t = sizeof(T);
+
+	// Select kernel by shape
+	std::string selected;
+	if ( kernel_name == NULL ){
+		selected = cl_matrix<T, Alloc>::product_select(device, M, N, K, &NDR);
+		kernel_name = selected.c_str();
+	}
 
-		// Kernel v3: mmul with 2D-thread reduction (__private)
-		// if (  strcmp (kernel_name, "f32_product_v3" ) == 0  ){
+	// Kernel variants share the launch configuration of their kernel. Hot shapes
+	// launch a variant specialized for the shape (see cl_device::get_specialized).
+	std::string launch_name = device.get_specialized( ( variant_name != NULL ) ? variant_name : kernel_name, M, N, K );
 
-		// 	// Define work per thread
-		// 	const int wptM = NDR[0];
-		// 	const int wptN = NDR[1];
+	// Launch descriptor (of the base kernel for variants)
+	const cl_product_launch* launch = cl_product_find(device, kernel_name);
+	if ( launch == NULL ){
+		printf("Kernel Error: Product kernel (%s) not found\n", kernel_name);
+		exit(1);
+	}
+
+	// Calculate transformed NDRange(s) (__gloabl/__local) and __local buffers
+	cl_product_config config = launch->configure(device, launch_name.c_str(), NDR, M, N, K, m_size_t);
 
-		// 	// Calculate transformed NDRange(s) (__gloabl/__local)
-		// 	cl::NDRange G_NDR( A.m / wptM, B.n / wptN );
-		// 	cl::NDRange L_NDR( NDR[0] / wptM, NDR[1] / wptN );
+	if ( device.local_mem_size != 0 && config.local_bytes > device.local_mem_size ){
+		printf("Kernel Error: Tiles (%d bytes) exceed __local memory (%d bytes)\n", 
+			(int)config.local_bytes, 
+			(int)device.local_mem_size
+		);
+		exit(1);
+	}
 
-		// 	// Set kernel args
-		// 	kernel.setArg(0, (const int)A.m);
-		// 	kernel.setArg(1, (const int)B.n);
-		// 	kernel.setArg(2, (const int)A.n);
-		// 	kernel.setArg(3, buffer_A);
-		// 	kernel.setArg(4, buffer_B);
-		// 	kernel.setArg(5, buffer_C);
-		// 	kernel.setArg(6, cl::Local( NDR[0]*NDR[1]*A.m_size_t ) );
-		// 	kernel.setArg(7, cl::Local( NDR[0]*NDR[1]*A.m_size_t ) );
-		// 	kernel.setArg(8, (const int)wptM);
-		// 	kernel.setArg(9, (const int)wptN);
+	if ( !cl_product_fits(device, config) ){
+		printf("Kernel Error: Workgroup of (%s) exceeds device maximum (%d threads)\n", 
+			launch_name.c_str(), 
+			(int)device.max_work_group_size
+		);
+		exit(1);
+	}
 
-		// 	// Enqueue buffer write and kernel execute commands
-		// 	queue.enqueueNDRangeKernel( kernel, cl::NullRange, G_NDR, L_NDR );
+	// Retrieve Kernel
+	cl::Kernel kernel = device.get_kernel(launch_name.c_str()); 
+
+	// Set kernel args (shared layout)
+	kernel.setArg(0, (const int)M);
+	kernel.setArg(1, (const int)N);
+	kernel.setArg(2, (const int)K);
+	kernel.setArg(3, buffer_A);
+	kernel.setArg(4, buffer_B);
+	kernel.setArg(5, buffer_C);
+	kernel.setArg(6, (const float)alpha);
+	kernel.setArg(7, (const float)beta);
+	cl_set_bias_arg(kernel, 8, buffer_bias);
+
+	for ( size_t i = 0; i < config.local_args.size(); i++ ){
+		kernel.setArg( (cl_uint)( 9 + i ), cl::Local( config.local_args[i] ) );
+	}
 
-		// 	// Blocking read of data into buffers
-		// 	queue.enqueueReadBuffer(buffer_C, CL_TRUE, 0, A.m_size_t*A.m*B.n, buffer);
-		// 	queue.finish();
-		// }
+	// Split-K: partial tiles of each split into scratch, then the reduction. 
+	// The scratch buffer returns to the pool here, which is safe since later
+	// commands on the (in order) queue run after the reduction.
+	if ( config.splits > 0 ){
 
+		std::shared_ptr<cl::Buffer> buffer_partial = device.get_buffer(CL_MEM_READ_WRITE, m_size_t*M*N*config.splits);
+		kernel.setArg(9, *buffer_partial);
+		kernel.setArg(10, (const int)config.splits);
 
-		// Create a new matrix and copy in data
-		cl_matrix<T> C(A.m, B.n, buffer);
-		free(buffer);
+		kernel.setArg(11, (const int)0);
+		queue.enqueueNDRangeKernel( kernel, cl::NullRange, config.global, config.local );
 
-		// Return matrix
-		return C;
+		kernel.setArg(11, (const int)1);
+		queue.enqueueNDRangeKernel( kernel, cl::NullRange, 
+			cl::NDRange( config.global[0], config.global[1], 1 ), config.local );
+		return;
 	}
 
-	// If exception is thrown it will be caught here
-	catch (cl::Error& e) {
-		printf("Runtime Error(%d): %s\n", e.err(), device.get_error_string( e.err() ) );
-		printf("  what(): %s\n", e.what() );
-		exit(1);
-	}	
-}
+	// Enqueue kernel execute command
+	queue.enqueueNDRangeKernel( kernel, cl::NullRange, config.global, config.local );
+}
\ No newline at end of file
@@ -0,0 +1,405 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> inc/extensions/cl_gemm.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+//
+// AuroraCL host GEMM: C(M,N) = A(M,K) * B(K,N) (row-major)
+//
+// Packed, cache-blocked GEMM with a register-blocked micro-kernel.
+//
+//	NC: columns of B held in a packed panel (L3)
+//	KC: depth of packed panels of A and B (L2/L1)
+//	MC: rows of A held in a packed panel (L2)
+//	MR x NR: register block computed by the micro-kernel
+//
+// A is packed into MR-row slivers and B into NR-column slivers (k-major) so
+// that the micro-kernel streams both operands contiguously. The micro-kernel
+// loads C on every KC panel after the first, so each element of C is summed
+// in the same k-order as the naive triple loop.
+//
+// Output tiles are distributed over the host thread pool (cl_threads.cpp).
+//
+// Micro-kernels use AVX-512 or AVX2/FMA intrinsics for float and double when
+// the compiler targets them (-march=native). Otherwise a portable kernel is
+// used, which the compiler is free to auto-vectorize.
+//
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+// Host thread pool
+#include "./cl_threads.cpp"
+
+#if defined(__AVX512F__) || ( defined(__AVX2__) && defined(__FMA__) )
+	#include <immintrin.h>
+#endif
+
+// Cache blocking parameters
+#define CL_GEMM_MC 96
+#define CL_GEMM_KC 256
+#define CL_GEMM_NC 4096
+
+// Products with fewer multiply-adds run single threaded
+#define CL_GEMM_MT_THRESHOLD (64*64*64)
+
+// Portable micro-kernel (any arithmetic type)
+template<class T>
+struct cl_gemm_kernel {
+
+	static const size_t MR = 4;
+	static const size_t NR = 8;
+
+	// c(MR,NR) = (first ? 0 : c) + a(MR,kc) * b(kc,NR)
+	static void compute(size_t kc, const T* a, const T* b, T* c, size_t ldc, bool first){
+
+		T acc[MR][NR];
+		for (size_t i = 0; i < MR; i++)
+			for (size_t j = 0; j < NR; j++)
+				acc[i][j] = first ? T(0) : c[i*ldc + j];
+
+		for (size_t p = 0; p < kc; p++){
+			for (size_t i = 0; i < MR; i++){
+				T a_i = a[p*MR + i];
+				for (size_t j = 0; j < NR; j++)
+					acc[i][j] += a_i * b[p*NR + j];
+			}
+		}
+
+		for (size_t i = 0; i < MR; i++)
+			for (size_t j = 0; j < NR; j++)
+				c[i*ldc + j] = acc[i][j];
+	}
+};
+
+#if defined(__AVX512F__)
+
+// AVX-512 micro-kernel (f32): 6 x 32 block in 12 zmm accumulators
+template<>
+struct cl_gemm_kernel<float> {
+
+	static const size_t MR = 6;
+	static const size_t NR = 32;
+
+	static void compute(size_t kc, const float* a, const float* b, float* c, size_t ldc, bool first){
+
+		__m512 acc[MR][2];
+		for (size_t i = 0; i < MR; i++){
+			acc[i][0] = first ? _mm512_setzero_ps() : _mm512_loadu_ps(c + i*ldc);
+			acc[i][1] = first ? _mm512_setzero_ps() : _mm512_loadu_ps(c + i*ldc + 16);
+		}
+
+		for (size_t p = 0; p < kc; p++){
+			__m512 b0 = _mm512_loadu_ps(b + p*NR);
+			__m512 b1 = _mm512_loadu_ps(b + p*NR + 16);
+			for (size_t i = 0; i < MR; i++){
+				__m512 a_i = _mm512_set1_ps(a[p*MR + i]);
+				acc[i][0] = _mm512_fmadd_ps(a_i, b0, acc[i][0]);
+				acc[i][1] = _mm512_fmadd_ps(a_i, b1, acc[i][1]);
+			}
+		}
+
+		for (size_t i = 0; i < MR; i++){
+			_mm512_storeu_ps(c + i*ldc, acc[i][0]);
+			_mm512_storeu_ps(c + i*ldc + 16, acc[i][1]);
+		}
+	}
+};
+
+// AVX-512 micro-kernel (f64): 6 x 16 block in 12 zmm accumulators
+template<>
+struct cl_gemm_kernel<double> {
+
+	static const size_t MR = 6;
+	static const size_t NR = 16;
+
+	static void compute(size_t kc, const double* a, const double* b, double* c, size_t ldc, bool first){
+
+		__m512d acc[MR][2];
+		for (size_t i = 0; i < MR; i++){
+			acc[i][0] = first ? _mm512_setzero_pd() : _mm512_loadu_pd(c + i*ldc);
+			acc[i][1] = first ? _mm512_setzero_pd() : _mm512_loadu_pd(c + i*ldc + 8);
+		}
+
+		for (size_t p = 0; p < kc; p++){
+			__m512d b0 = _mm512_loadu_pd(b + p*NR);
+			__m512d b1 = _mm512_loadu_pd(b + p*NR + 8);
+			for (size_t i = 0; i < MR; i++){
+				__m512d a_i = _mm512_set1_pd(a[p*MR + i]);
+				acc[i][0] = _mm512_fmadd_pd(a_i, b0, acc[i][0]);
+				acc[i][1] = _mm512_fmadd_pd(a_i, b1, acc[i][1]);
+			}
+		}
+
+		for (size_t i = 0; i < MR; i++){
+			_mm512_storeu_pd(c + i*ldc, acc[i][0]);
+			_mm512_storeu_pd(c + i*ldc + 8, acc[i][1]);
+		}
+	}
+};
+
+#elif defined(__AVX2__) && defined(__FMA__)
+
+// AVX2 micro-kernel (f32): 6 x 16 block in 12 ymm accumulators
+template<>
+struct cl_gemm_kernel<float> {
+
+	static const size_t MR = 6;
+	static const size_t NR = 16;
+
+	static void compute(size_t kc, const float* a, const float* b, float* c, size_t ldc, bool first){
+
+		__m256 acc[MR][2];
+		for (size_t i = 0; i < MR; i++){
+			acc[i][0] = first ? _mm256_setzero_ps() : _mm256_loadu_ps(c + i*ldc);
+			acc[i][1] = first ? _mm256_setzero_ps() : _mm256_loadu_ps(c + i*ldc + 8);
+		}
+
+		for (size_t p = 0; p < kc; p++){
+			__m256 b0 = _mm256_loadu_ps(b + p*NR);
+			__m256 b1 = _mm256_loadu_ps(b + p*NR + 8);
+			for (size_t i = 0; i < MR; i++){
+				__m256 a_i = _mm256_broadcast_ss(a + p*MR + i);
+				acc[i][0] = _mm256_fmadd_ps(a_i, b0, acc[i][0]);
+				acc[i][1] = _mm256_fmadd_ps(a_i, b1, acc[i][1]);
+			}
+		}
+
+		for (size_t i = 0; i < MR; i++){
+			_mm256_storeu_ps(c + i*ldc, acc[i][0]);
+			_mm256_storeu_ps(c + i*ldc + 8, acc[i][1]);
+		}
+	}
+};
+
+// AVX2 micro-kernel (f64): 6 x 8 block in 12 ymm accumulators
+template<>
+struct cl_gemm_kernel<double> {
+
+	static const size_t MR = 6;
+	static const size_t NR = 8;
+
+	static void compute(size_t kc, const double* a, const double* b, double* c, size_t ldc, bool first){
+
+		__m256d acc[MR][2];
+		for (size_t i = 0; i < MR; i++){
+			acc[i][0] = first ? _mm256_setzero_pd() : _mm256_loadu_pd(c + i*ldc);
+			acc[i][1] = first ? _mm256_setzero_pd() : _mm256_loadu_pd(c + i*ldc + 4);
+		}
+
+		for (size_t p = 0; p < kc; p++){
+			__m256d b0 = _mm256_loadu_pd(b + p*NR);
+			__m256d b1 = _mm256_loadu_pd(b + p*NR + 4);
+			for (size_t i = 0; i < MR; i++){
+				__m256d a_i = _mm256_broadcast_sd(a + p*MR + i);
+				acc[i][0] = _mm256_fmadd_pd(a_i, b0, acc[i][0]);
+				acc[i][1] = _mm256_fmadd_pd(a_i, b1, acc[i][1]);
+			}
+		}
+
+		for (size_t i = 0; i < MR; i++){
+			_mm256_storeu_pd(c + i*ldc, acc[i][0]);
+			_mm256_storeu_pd(c + i*ldc + 4, acc[i][1]);
+		}
+	}
+};
+
+#endif
+
+// Pack A(mc,kc) into MR-row slivers (k-major, zero padded)
+template<class T>
+void cl_gemm_pack_a(size_t mc, size_t kc, const T* A, size_t lda, T* a){
+
+	const size_t MR = cl_gemm_kernel<T>::MR;
+
+	for (size_t ir = 0; ir < mc; ir += MR){
+		for (size_t p = 0; p < kc; p++){
+			for (size_t i = 0; i < MR; i++){
+				*a++ = ( ir + i < mc ) ? A[(ir + i)*lda + p] : T(0);
+			}
+		}
+	}
+}
+
+// Pack B(kc,nc) into NR-column slivers (k-major, zero padded)
+template<class T>
+void cl_gemm_pack_b(size_t kc, size_t nc, const T* B, size_t ldb, T* b){
+
+	const size_t NR = cl_gemm_kernel<T>::NR;
+
+	for (size_t jr = 0; jr < nc; jr += NR){
+		for (size_t p = 0; p < kc; p++){
+			for (size_t j = 0; j < NR; j++){
+				*b++ = ( jr + j < nc ) ? B[p*ldb + jr + j] : T(0);
+			}
+		}
+	}
+}
+
+// Compute one MR x NR block of C (edge blocks are staged in a local tile)
+template<class T>
+void cl_gemm_block(size_t mr, size_t nr, size_t kc, const T* a, const T* b, T* C, size_t ldc, bool first){
+
+	const size_t MR = cl_gemm_kernel<T>::MR;
+	const size_t NR = cl_gemm_kernel<T>::NR;
+
+	// Full register block
+	if ( mr == MR && nr == NR ){
+		cl_gemm_kernel<T>::compute(kc, a, b, C, ldc, first);
+		return;
+	}
+
+	// Partial register block
+	T c[MR*NR];
+	for (size_t i = 0; i < MR; i++)
+		for (size_t j = 0; j < NR; j++)
+			c[i*NR + j] = ( !first && i < mr && j < nr ) ? C[i*ldc + j] : T(0);
+
+	cl_gemm_kernel<T>::compute(kc, a, b, c, NR, first);
+
+	for (size_t i = 0; i < mr; i++)
+		for (size_t j = 0; j < nr; j++)
+			C[i*ldc + j] = c[i*NR + j];
+}
+
+// Pack column tile B(0:K, jc:jc+nc) as consecutive KC panels. The panel at
+// depth pc starts at pc * round_up(nc, NR).
+template<class T>
+void cl_gemm_pack_b_tile(size_t jc, size_t nc, size_t K, const T* B, size_t ldb, T* b){
+
+	const size_t NR = cl_gemm_kernel<T>::NR;
+	const size_t KC = CL_GEMM_KC;
+	const size_t ncp = ( ( nc + NR - 1 ) / NR ) * NR;
+
+	for (size_t pc = 0; pc < K; pc += KC){
+		cl_gemm_pack_b(std::min(KC, K - pc), nc, B + pc*ldb + jc, ldb, b + pc*ncp);
+	}
+}
+
+// Compute tile C(ic:ic+mc, jc:jc+nc) over all of K. The column tile of B is
+// packed by the caller (cl_gemm_pack_b_tile) and shared by all row tiles.
+template<class T>
+void cl_gemm_tile(size_t ic, size_t mc, size_t jc, size_t nc, size_t K,
+	const T* A, size_t lda, const T* b_tile, T* C, size_t ldc){
+
+	const size_t MR = cl_gemm_kernel<T>::MR;
+	const size_t NR = cl_gemm_kernel<T>::NR;
+	const size_t KC = CL_GEMM_KC;
+	const size_t ncp = ( ( nc + NR - 1 ) / NR ) * NR;
+
+	// Packing buffer of A (per thread, reused across calls)
+	static thread_local std::vector<T> a;
+	a.resize( ( ( mc + MR - 1 ) / MR ) * MR * std::min(K, KC) );
+
+	for (size_t pc = 0; pc < K; pc += KC){
+		size_t kc = std::min(KC, K - pc);
+
+		// Pack panel of A (panel of B is packed)
+		const T* b = b_tile + pc*ncp;
+		cl_gemm_pack_a(mc, kc, A + ic*lda + pc, lda, &a[0]);
+
+		// Register blocks
+		for (size_t jr = 0; jr < nc; jr += NR){
+			for (size_t ir = 0; ir < mc; ir += MR){
+				cl_gemm_block(
+					std::min(MR, mc - ir),
+					std::min(NR, nc - jr),
+					kc,
+					&a[ir*kc],
+					b + jr*kc,
+					C + (ic + ir)*ldc + (jc + jr),
+					ldc,
+					pc == 0
+				);
+			}
+		}
+	}
+}
+
+// Host GEMM driver: C(M,N) = A(M,K) * B(K,N)
+//
+// C is split into MC x NT tiles which are computed independently on the host
+// thread pool. Every element of C is computed by exactly one micro-kernel call
+// sequence, so results do not depend on the number of threads. Each column
+// tile of B is packed once up front and shared by all row tiles.
+template<class T>
+void cl_gemm(size_t M, size_t N, size_t K, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc){
+
+	const size_t MR = cl_gemm_kernel<T>::MR;
+	const size_t NR = cl_gemm_kernel<T>::NR;
+
+	// Degenerate product
+	if ( K == 0 ){
+		for (size_t i = 0; i < M; i++)
+			for (size_t j = 0; j < N; j++)
+				C[i*ldc + j] = T(0);
+		return;
+	}
+
+	// Tile sizes (rounded to register blocks)
+	const size_t MC = ( CL_GEMM_MC / MR ) * MR;
+	size_t NT = ( CL_GEMM_NC / NR ) * NR;
+
+	// Small products run on the calling thread
+	cl_thread_pool& pool = cl_host_pool();
+	size_t threads = ( M*N*K < CL_GEMM_MT_THRESHOLD ) ? 1 : pool.size();
+
+	// Narrow column tiles until there are enough tiles to balance threads
+	size_t tiles_m = ( M + MC - 1 ) / MC;
+	while ( threads > 1 && NT > 4*NR && tiles_m * ( ( N + NT - 1 ) / NT ) < 4*threads ){
+		NT = std::max( ( NT / 2 / NR ) * NR, 4*NR );
+	}
+	size_t tiles_n = ( N + NT - 1 ) / NT;
+
+	// Packed B (shared by the pool threads). Column tile jc starts at 
+	// jc*K since all but the last tile are multiples of NR wide.
+	std::vector<T> b( ( ( N + NR - 1 ) / NR ) * NR * K );
+	T* b_data = &b[0];
+
+	auto pack = [=](size_t t){
+		size_t jc = t * NT;
+		cl_gemm_pack_b_tile(jc, std::min(NT, N - jc), K, B, ldb, b_data + jc*K);
+	};
+
+	// Compute tile (row-major tile order)
+	auto tile = [=](size_t t){
+		size_t ic = ( t / tiles_n ) * MC;
+		size_t jc = ( t % tiles_n ) * NT;
+		cl_gemm_tile(ic, std::min(MC, M - ic), jc, std::min(NT, N - jc), K, A, lda, b_data + jc*K, C, ldc);
+	};
+
+	if ( threads == 1 ){
+		for (size_t t = 0; t < tiles_n; t++){
+			pack(t);
+		}
+		for (size_t t = 0; t < tiles_m * tiles_n; t++){
+			tile(t);
+		}
+	}
+	else {
+		pool.parallel_for( tiles_n, pack );
+		pool.parallel_for( tiles_m * tiles_n, tile );
+	}
+}
\ No newline at end of file
@@ -0,0 +1,274 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> inc/extensions/cl_threads.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+// Standard libraries
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+// Persistent host thread pool. Workers are created once and sleep between
+// calls to parallel_for(). Each call splits the task indices into contiguous
+// ranges (one per participant, the calling thread included). A participant
+// drains its own range from the front and, once empty, steals single tasks
+// from the back of the other ranges.
+//
+// Nested calls (from within a task) and pools of size one run serially. The
+// pool should not be resized while other threads are submitting work.
+class cl_thread_pool {
+
+	public:
+
+		// Constructors (threads = 0 uses all hardware threads)
+		cl_thread_pool(size_t threads = 0);
+		~cl_thread_pool(void);
+
+		// Number of participating threads (including caller)
+		size_t size(void);
+
+		// Change number of participating threads
+		void resize(size_t threads = 0);
+
+		// Run task(i) for i in [0, tasks) and wait for completion
+		void parallel_for(size_t tasks, const std::function<void(size_t)>& task);
+
+	private:
+
+		// Task range owned by each participant
+		struct cl_task_range {
+			std::mutex lock;
+			size_t begin;
+			size_t end;
+		};
+
+		// Worker threads and task ranges
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<cl_task_range>> ranges;
+
+		// Current task and worker synchronization
+		const std::function<void(size_t)>* task;
+		std::mutex lock;
+		std::condition_variable wake;
+		std::condition_variable done;
+		size_t generation;
+		size_t active;
+		bool stop;
+
+		// Serializes calls to parallel_for and resize
+		std::mutex dispatch;
+
+		// Thread management
+		void start(size_t threads);
+		void join(void);
+
+		// Worker loop and task execution
+		void worker(size_t id, size_t seen);
+		void run(size_t id);
+		bool next(size_t id, size_t& t);
+
+		// Flag set on threads currently executing tasks
+		static bool& in_pool(void);
+};
+
+// Constructor
+cl_thread_pool::cl_thread_pool(size_t threads){
+
+	this->task = NULL;
+	this->generation = 0;
+	this->active = 0;
+	this->stop = false;
+
+	this->start(threads);
+}
+
+// Destructor
+cl_thread_pool::~cl_thread_pool(void){ this->join(); }
+
+// Flag set on threads currently executing tasks
+bool& cl_thread_pool::in_pool(void){
+	static thread_local bool flag = false;
+	return flag;
+}
+
+// Number of participating threads
+size_t cl_thread_pool::size(void){ return this->ranges.size(); }
+
+// Change number of participating threads
+void cl_thread_pool::resize(size_t threads){
+
+	std::lock_guard<std::mutex> guard(this->dispatch);
+
+	this->join();
+	this->start(threads);
+}
+
+// Create workers (the calling thread is participant 0)
+void cl_thread_pool::start(size_t threads){
+
+	if ( threads == 0 ){
+		threads = std::max( (size_t)std::thread::hardware_concurrency(), (size_t)1 );
+	}
+
+	this->stop = false;
+	this->ranges.clear();
+	for (size_t i = 0; i < threads; i++){
+		this->ranges.push_back( std::unique_ptr<cl_task_range>( new cl_task_range() ) );
+		this->ranges.back()->begin = 0;
+		this->ranges.back()->end = 0;
+	}
+
+	for (size_t i = 1; i < threads; i++){
+		this->workers.push_back( std::thread(&cl_thread_pool::worker, this, i, this->generation) );
+	}
+}
+
+// Stop and join workers
+void cl_thread_pool::join(void){
+
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->stop = true;
+	}
+	this->wake.notify_all();
+
+	for (std::thread& t : this->workers){
+		t.join();
+	}
+	this->workers.clear();
+}
+
+// Worker loop: sleep until a new generation of tasks is posted (seen is the
+// generation at the time the worker was created)
+void cl_thread_pool::worker(size_t id, size_t seen){
+
+	this->in_pool() = true;
+
+	while (true){
+
+		{
+			std::unique_lock<std::mutex> guard(this->lock);
+			this->wake.wait(guard, [&]{ return this->stop || this->generation != seen; });
+			if ( this->stop ){
+				return;
+			}
+			seen = this->generation;
+		}
+
+		this->run(id);
+
+		{
+			std::lock_guard<std::mutex> guard(this->lock);
+			if ( --this->active == 0 ){
+				this->done.notify_all();
+			}
+		}
+	}
+}
+
+// Execute tasks until all ranges are empty
+void cl_thread_pool::run(size_t id){
+
+	size_t t;
+	while ( this->next(id, t) ){
+		(*this->task)(t);
+	}
+}
+
+// Take next task from own range (front) or steal from another (back)
+bool cl_thread_pool::next(size_t id, size_t& t){
+
+	size_t n = this->ranges.size();
+
+	for (size_t i = 0; i < n; i++){
+
+		cl_task_range& range = *this->ranges[ (id + i) % n ];
+		std::lock_guard<std::mutex> guard(range.lock);
+
+		if ( range.begin < range.end ){
+			t = ( i == 0 ) ? range.begin++ : --range.end;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Run task(i) for i in [0, tasks) and wait for completion
+void cl_thread_pool::parallel_for(size_t tasks, const std::function<void(size_t)>& task){
+
+	// Serial execution (nested call or single task)
+	if ( this->in_pool() || tasks <= 1 ){
+		for (size_t t = 0; t < tasks; t++){
+			task(t);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(this->dispatch);
+
+	// Serial execution (single thread pool)
+	if ( this->workers.empty() ){
+		for (size_t t = 0; t < tasks; t++){
+			task(t);
+		}
+		return;
+	}
+
+	// Split task indices into contiguous ranges
+	size_t n = this->ranges.size();
+	for (size_t i = 0; i < n; i++){
+		std::lock_guard<std::mutex> range_guard(this->ranges[i]->lock);
+		this->ranges[i]->begin = ( tasks * i ) / n;
+		this->ranges[i]->end   = ( tasks * (i + 1) ) / n;
+	}
+
+	// Post tasks to workers
+	{
+		std::lock_guard<std::mutex> lock_guard(this->lock);
+		this->task = &task;
+		this->active = this->workers.size();
+		this->generation++;
+	}
+	this->wake.notify_all();
+
+	// Calling thread participates
+	this->in_pool() = true;
+	this->run(0);
+	this->in_pool() = false;
+
+	// Wait for workers to finish
+	std::unique_lock<std::mutex> lock_guard(this->lock);
+	this->done.wait(lock_guard, [&]{ return this->active == 0; });
+	this->task = NULL;
+}
+
+// Host thread pool shared by all cl_matrix objects
+inline cl_thread_pool& cl_host_pool(void){
+	static cl_thread_pool pool;
+	return pool;
+}
\ No newline at end of file
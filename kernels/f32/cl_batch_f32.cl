@@ -0,0 +1,118 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> kernels/f32/cl_batch_f32.cl
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+//
+// AuroraCL Kernels for Batched Matrix Product (f32). 
+//
+// Kernel Status:
+// f32_product_batched: Confirmed
+//
+// matrix_a = batch x m(rows) x k(cols)
+// matrix_b = batch x k(rows) x n(cols)
+// matrix_c = batch x m(rows) x n(cols)
+//
+// Matrices of a batch are stored contiguously, STRIDE elements apart. A stride 
+// of zero broadcasts a single matrix over the batch (e.g. one B for all A).
+//
+// f32_product_batched: leveraging local memory over a batch of small matrices. 
+// The batch index is the third NDRange dimension, so the whole batch runs in 
+// a single launch. Workgroup is TILE_SIZE x TILE_SIZE x 1 and any M, N and K 
+// are valid (the host rounds the global range up to whole tiles).
+__kernel void f32_product_batched (
+		const int M, 
+		const int N, 
+		const int K, 
+		const int STRIDE_A,
+		const int STRIDE_B,
+		const int STRIDE_C,
+		__global float *A, 
+		__global float *B, 
+		__global float *C )
+
+{
+	// Kernel Preprocessor
+	#pragma PKP TILE_SIZE __default 16
+	#ifndef TILE_SIZE
+		#define TILE_SIZE 16
+	#endif
+
+	// Thread identifiers (__global)
+	const int GLOBAL_M = get_global_id(0);
+	const int GLOBAL_N = get_global_id(1);
+	const int BATCH = get_global_id(2);
+
+	// Thread identifiers (__local)
+	const int LOCAL_M = get_local_id(0); 
+	const int LOCAL_N = get_local_id(1); 
+
+	// Matrices of this batch entry
+	__global const float *Ab = A + (long)BATCH * STRIDE_A;
+	__global const float *Bb = B + (long)BATCH * STRIDE_B;
+	__global float *Cb = C + (long)BATCH * STRIDE_C;
+
+	// Number of tiles along K (last tile may be partial)
+	const int N_TILES = ( K + TILE_SIZE - 1 ) / TILE_SIZE;
+
+	// Local tiles (shared by the workgroup)
+	__local float Asub[ TILE_SIZE ][ TILE_SIZE ];
+	__local float Bsub[ TILE_SIZE ][ TILE_SIZE ];
+
+	// Initialize accumulation buffer
+	float acc = 0.0f;
+
+	// Perform the calculation
+	for ( int tile = 0; tile < N_TILES; tile++ ){
+
+		// Offset variable
+		int TILE_OFFSET = (tile)*(TILE_SIZE);
+
+		// Load tiles of A and B (zero padded outside of the matrices)
+		int aCOL = TILE_OFFSET + LOCAL_N;
+		int bROW = TILE_OFFSET + LOCAL_M;
+
+		Asub[ LOCAL_M ][ LOCAL_N ] = ( GLOBAL_M < M && aCOL < K ) ? Ab[ ( GLOBAL_M * K ) + aCOL ] : 0.0f;
+		Bsub[ LOCAL_M ][ LOCAL_N ] = ( bROW < K && GLOBAL_N < N ) ? Bb[ ( bROW * N ) + GLOBAL_N ] : 0.0f;
+
+		// Synchronization barrier (load)
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Multiply submatrices
+		for ( int IT = 0; IT < TILE_SIZE; IT++ ){
+			acc += Asub[ LOCAL_M ][ IT ] * Bsub[ IT ][ LOCAL_N ];
+		}
+
+		// Synchronization barrier (compute)
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Store result
+	if ( GLOBAL_M < M && GLOBAL_N < N ){
+		Cb[ ( GLOBAL_M * N ) + GLOBAL_N ] = acc;
+	}
+
+	#undef TILE_SIZE
+	#pragma PKP QED
+}
\ No newline at end of file
@@ -31,11 +31,36 @@
 // f32_product_v0: Confirmed
 // f32_product_v1: Confirmed
 // f32_product_v2: Confirmed
+// f32_product_v3: Confirmed
+// f32_product_v4: Confirmed
+// f32_product_v5: Confirmed
+// f32_product_v6: Confirmed
+// f32_product_v7: Confirmed
+// f32_product_v8: Confirmed
 //
 // matrix_a = m(rows) x k(cols)
 // matrix_b = k(rows) x n(cols)
 // matrix_c = m(rows) x n(cols)
 //
+// f32_product_v5 takes matrix_b packed as its transpose, n(rows) x k(cols)
+// f32_product_v8 is launched twice on a scratch buffer (split-K, see below)
+//
+// All kernels compute matrix_c = ALPHA * matrix_a * matrix_b + BETA * matrix_c. 
+// When BETA is zero matrix_c is not read (it may be uninitialized).
+//
+// Each stored value then passes through the PKP constant EPILOGUE, an expression
+// in VAL (the value above) and COL (its column in matrix_c). It defaults to VAL. 
+// Kernel variants generated by the host set it to apply a bias (BIAS[ COL ]) 
+// and/or an activation in registers before the store.
+//
+// The PKP constants SHAPE_M, SHAPE_N and SHAPE_K (zero by default) specialize
+// a kernel for one shape: when nonzero they replace the arguments of the same
+// name with constants.
+//
+// All kernels accept any M, N and K. The host rounds the global range up to
+// whole workgroups (tiles). Partial tiles are zero padded on load and stores
+// outside of matrix_c are skipped.
+//
 // f32_product_v0: naive algorithm 
 __kernel void f32_product_v0 ( 
 	const int M,
@@ -43,9 +68,46 @@ __kernel void f32_product_v0 (
 	const int K,
 	__global float *A,
 	__global float *B,
-	__global float *C )
+	__global float *C,
+	const float ALPHA,
+	const float BETA,
+	__global const float *BIAS )
 
 {
+	// Kernel Preprocessor
+	#pragma PKP EPILOGUE __default VAL
+	#ifndef EPILOGUE
+		#define EPILOGUE VAL
+	#endif
+
+	#pragma PKP SHAPE_M __default 0
+	#ifndef SHAPE_M
+		#define SHAPE_M 0
+	#endif
+
+	#pragma PKP SHAPE_N __default 0
+	#ifndef SHAPE_N
+		#define SHAPE_N 0
+	#endif
+
+	#pragma PKP SHAPE_K __default 0
+	#ifndef SHAPE_K
+		#define SHAPE_K 0
+	#endif
+
+	// Shape specialized variants (nonzero SHAPE_M/N/K) replace the arguments 
+	// M, N and K with constants, so that loops over K unroll and the bounds 
+	// checks of whole tiles fold away. The host passes the same values.
+	#if SHAPE_M
+		#define M SHAPE_M
+	#endif
+	#if SHAPE_N
+		#define N SHAPE_N
+	#endif
+	#if SHAPE_K
+		#define K SHAPE_K
+	#endif
+
 	// Thread identifiers (__global)
 	const int GLOBAL_M = get_global_id(0);
 	const int GLOBAL_N = get_global_id(1); 
@@ -53,6 +115,9 @@ __kernel void f32_product_v0 (
 	// Global identifier
 	const int gINDEX = ( GLOBAL_M * N ) + GLOBAL_N;
 
+	// Threads outside of C (rounded global range)
+	if ( GLOBAL_M >= M || GLOBAL_N >= N ){ return; }
+
 	// Allocate accumulation buffer
 	float acc = 0.0f;
 
@@ -66,7 +131,16 @@ __kernel void f32_product_v0 (
 	}
 	
 	// Store result
-	C[ gINDEX ] = acc;	
+	int COL = GLOBAL_N;
+	float VAL = ( BETA == 0.0f ) ? ALPHA * acc : ALPHA * acc + BETA * C[ gINDEX ];
+	C[ gINDEX ] = EPILOGUE;
+	#undef M
+	#undef N
+	#undef K
+	#undef SHAPE_M
+	#undef SHAPE_N
+	#undef SHAPE_K
+	#undef EPILOGUE
 	#pragma PKP QED
 } 
 
@@ -78,10 +152,45 @@ __kernel void f32_product_v1 (
 		__global float *A, 
 		__global float *B, 
 		__global float *C,
+		const float ALPHA,
+		const float BETA,
+		__global const float *BIAS,
 		__local float *Asub,
 		__local float *Bsub )
 
 {
+	// Kernel Preprocessor
+	#pragma PKP EPILOGUE __default VAL
+	#ifndef EPILOGUE
+		#define EPILOGUE VAL
+	#endif
+
+	#pragma PKP SHAPE_M __default 0
+	#ifndef SHAPE_M
+		#define SHAPE_M 0
+	#endif
+
+	#pragma PKP SHAPE_N __default 0
+	#ifndef SHAPE_N
+		#define SHAPE_N 0
+	#endif
+
+	#pragma PKP SHAPE_K __default 0
+	#ifndef SHAPE_K
+		#define SHAPE_K 0
+	#endif
+
+	// Shape specialization (see f32_product_v0)
+	#if SHAPE_M
+		#define M SHAPE_M
+	#endif
+	#if SHAPE_N
+		#define N SHAPE_N
+	#endif
+	#if SHAPE_K
+		#define K SHAPE_K
+	#endif
+
 	// Thread identifiers (__global)
 	const int GLOBAL_M = get_global_id(0);
 	const int GLOBAL_N = get_global_id(1);
@@ -101,7 +210,7 @@ __kernel void f32_product_v1 (
 	// Define tile sizes and calculate the number of tiles
 	const int TILE_SIZE_M = LOCAL_SIZE_M;
 	const int TILE_SIZE_N = LOCAL_SIZE_N; 
-	const int N_TILES = K / TILE_SIZE_N;
+	const int N_TILES = ( K + TILE_SIZE_N - 1 ) / TILE_SIZE_N;
 
 	// Initialize accumulation buffer
 	float acc = 0.0f;
@@ -116,9 +225,9 @@ __kernel void f32_product_v1 (
 		int aINDEX = ( GLOBAL_M * K ) + ( TILE_OFFSET + LOCAL_N );
 		int bINDEX = ( ( TILE_OFFSET + LOCAL_M ) * N ) + ( GLOBAL_N );	
 
-		// Copy submatrices into local memory
-		Asub[ lINDEX ] = A[ aINDEX ];
-		Bsub[ lINDEX ] = B[ bINDEX ];
+		// Copy submatrices into local memory (zero padded)
+		Asub[ lINDEX ] = ( GLOBAL_M < M && TILE_OFFSET + LOCAL_N < K ) ? A[ aINDEX ] : 0.0f;
+		Bsub[ lINDEX ] = ( TILE_OFFSET + LOCAL_M < K && GLOBAL_N < N ) ? B[ bINDEX ] : 0.0f;
 
 		// Synchronization barrier (load)
 		barrier( CLK_LOCAL_MEM_FENCE );
@@ -135,7 +244,18 @@ __kernel void f32_product_v1 (
 	}
 	
 	// Store result
-	C[ gINDEX ] = acc;
+	if ( GLOBAL_M < M && GLOBAL_N < N ){
+		int COL = GLOBAL_N;
+		float VAL = ( BETA == 0.0f ) ? ALPHA * acc : ALPHA * acc + BETA * C[ gINDEX ];
+		C[ gINDEX ] = EPILOGUE;
+	}
+	#undef M
+	#undef N
+	#undef K
+	#undef SHAPE_M
+	#undef SHAPE_N
+	#undef SHAPE_K
+	#undef EPILOGUE
 	#pragma PKP QED
 }
 
@@ -147,11 +267,45 @@ __kernel void f32_product_v2 (
 		__global float *A, 
 		__global float *B, 
 		__global float *C,
+		const float ALPHA,
+		const float BETA,
+		__global const float *BIAS,
 		__local float *Asub,
 		__local float *Bsub )
 
 {
 	// Kernel Preprocessor
+	#pragma PKP EPILOGUE __default VAL
+	#ifndef EPILOGUE
+		#define EPILOGUE VAL
+	#endif
+
+	#pragma PKP SHAPE_M __default 0
+	#ifndef SHAPE_M
+		#define SHAPE_M 0
+	#endif
+
+	#pragma PKP SHAPE_N __default 0
+	#ifndef SHAPE_N
+		#define SHAPE_N 0
+	#endif
+
+	#pragma PKP SHAPE_K __default 0
+	#ifndef SHAPE_K
+		#define SHAPE_K 0
+	#endif
+
+	// Shape specialization (see f32_product_v0)
+	#if SHAPE_M
+		#define M SHAPE_M
+	#endif
+	#if SHAPE_N
+		#define N SHAPE_N
+	#endif
+	#if SHAPE_K
+		#define K SHAPE_K
+	#endif
+
 	#pragma PKP WORK_PER_THREAD_N __default 8
 	#ifndef WORK_PER_THREAD_N
 		#define WORK_PER_THREAD_N 8
@@ -174,7 +328,7 @@ __kernel void f32_product_v2 (
 
 	// Calculate number of tiles
 	const int TILE_SIZE_N = LOCAL_SIZE_N; 
-	const int N_TILES = get_num_groups(0);
+	const int N_TILES = ( K + TILE_SIZE_N * WPTN - 1 ) / ( TILE_SIZE_N * WPTN );
 
 	// Initialize Aregister and accumulation buffer
 	__private float Areg;
@@ -197,9 +351,9 @@ __kernel void f32_product_v2 (
 			int aINDEX = ( ( GLOBAL_M ) * K ) + ( TILE_OFFSET + wN );
 			int bINDEX = ( ( TILE_OFFSET + LOCAL_M ) * N ) + ( GLOBAL_N * WPTN  + wN );
 
-			// Store values in local memory
-			Asub[ lINDEX ] = A[ aINDEX ];
-			Bsub[ lINDEX ] = B[ bINDEX ];
+			// Store values in local memory (zero padded)
+			Asub[ lINDEX ] = ( GLOBAL_M < M && TILE_OFFSET + wN < K ) ? A[ aINDEX ] : 0.0f;
+			Bsub[ lINDEX ] = ( TILE_OFFSET + LOCAL_M < K && GLOBAL_N * WPTN + wN < N ) ? B[ bINDEX ] : 0.0f;
 		}
 
 		// Synchronization barrier (load)
@@ -226,7 +380,1270 @@ __kernel void f32_product_v2 (
 	// Store the result	
 	for (int wN = 0; wN < WPTN; wN++ ) {
 		int gINDEX = ( GLOBAL_M * N ) + ( GLOBAL_N * WPTN + wN );
-		C[ gINDEX ] = acc[ wN ];
+		if ( GLOBAL_M < M && GLOBAL_N * WPTN + wN < N ){
+			int COL = GLOBAL_N * WPTN + wN;
+			float VAL = ( BETA == 0.0f ) ? ALPHA * acc[ wN ] : ALPHA * acc[ wN ] + BETA * C[ gINDEX ];
+			C[ gINDEX ] = EPILOGUE;
+		}
+	}
+	#undef WORK_PER_THREAD_N
+	#undef M
+	#undef N
+	#undef K
+	#undef SHAPE_M
+	#undef SHAPE_N
+	#undef SHAPE_K
+	#undef EPILOGUE
+	#pragma PKP QED
+}
+
+// f32_product_v3: 2D register tiling (i.e. '2D more work per thread')
+//
+// Each workgroup computes a TILE_SIZE_M x TILE_SIZE_N tile of C, and each thread 
+// a WORK_PER_THREAD_M x WORK_PER_THREAD_N block of that tile held in registers. 
+// Workgroup is (TILE_SIZE_M/WORK_PER_THREAD_M) x (TILE_SIZE_N/WORK_PER_THREAD_N). 
+// Tiles of A and B are loaded cooperatively into __local memory in steps of 
+// TILE_SIZE_K along K.
+__kernel void f32_product_v3 (
+		const int M, 
+		const int N, 
+		const int K, 
+		__global float *A, 
+		__global float *B, 
+		__global float *C,
+		const float ALPHA,
+		const float BETA,
+		__global const float *BIAS )
+
+{
+	// Kernel Preprocessor
+	#pragma PKP EPILOGUE __default VAL
+	#ifndef EPILOGUE
+		#define EPILOGUE VAL
+	#endif
+
+	#pragma PKP SHAPE_M __default 0
+	#ifndef SHAPE_M
+		#define SHAPE_M 0
+	#endif
+
+	#pragma PKP SHAPE_N __default 0
+	#ifndef SHAPE_N
+		#define SHAPE_N 0
+	#endif
+
+	#pragma PKP SHAPE_K __default 0
+	#ifndef SHAPE_K
+		#define SHAPE_K 0
+	#endif
+
+	// Shape specialization (see f32_product_v0)
+	#if SHAPE_M
+		#define M SHAPE_M
+	#endif
+	#if SHAPE_N
+		#define N SHAPE_N
+	#endif
+	#if SHAPE_K
+		#define K SHAPE_K
+	#endif
+
+	#pragma PKP TILE_SIZE_M __default 64
+	#ifndef TILE_SIZE_M
+		#define TILE_SIZE_M 64
+	#endif
+
+	#pragma PKP TILE_SIZE_N __default 64
+	#ifndef TILE_SIZE_N
+		#define TILE_SIZE_N 64
+	#endif
+
+	#pragma PKP TILE_SIZE_K __default 16
+	#ifndef TILE_SIZE_K
+		#define TILE_SIZE_K 16
+	#endif
+
+	#pragma PKP WORK_PER_THREAD_M __default 8
+	#ifndef WORK_PER_THREAD_M
+		#define WORK_PER_THREAD_M 8
+	#endif
+
+	#pragma PKP WORK_PER_THREAD_N __default 8
+	#ifndef WORK_PER_THREAD_N
+		#define WORK_PER_THREAD_N 8
+	#endif
+
+	// Threads per workgroup (reduced tile size)
+	#define RTS_M ( TILE_SIZE_M / WORK_PER_THREAD_M )
+	#define RTS_N ( TILE_SIZE_N / WORK_PER_THREAD_N )
+	#define N_THREADS ( RTS_M * RTS_N )
+
+	// Tile loads must divide evenly over the workgroup
+	#if ( TILE_SIZE_M % WORK_PER_THREAD_M ) || ( TILE_SIZE_N % WORK_PER_THREAD_N )
+		#error "f32_product_v3: TILE_SIZE_M/N must be multiples of WORK_PER_THREAD_M/N"
+	#endif
+	#if ( ( TILE_SIZE_M * TILE_SIZE_K ) % N_THREADS ) || ( ( TILE_SIZE_K * TILE_SIZE_N ) % N_THREADS )
+		#error "f32_product_v3: Tiles of A and B must divide evenly over the workgroup"
+	#endif
+
+	// Thread identifiers (__local)
+	const int LOCAL_M = get_local_id(0);
+	const int LOCAL_N = get_local_id(1);
+	const int LOCAL_ID = ( LOCAL_M * RTS_N ) + LOCAL_N;
+
+	// Tile offsets in C
+	const int OFFSET_M = TILE_SIZE_M * get_group_id(0);
+	const int OFFSET_N = TILE_SIZE_N * get_group_id(1);
+
+	// Number of tiles along K (last tile may be partial)
+	const int N_TILES = ( K + TILE_SIZE_K - 1 ) / TILE_SIZE_K;
+
+	// Local tiles (shared by the workgroup). Asub is stored transposed so 
+	// that both tiles are read along rows in the inner product loop.
+	__local float Asub[ TILE_SIZE_K ][ TILE_SIZE_M ];
+	__local float Bsub[ TILE_SIZE_K ][ TILE_SIZE_N ];
+
+	// Allocate registers and initialize accumulation buffer
+	__private float Areg;
+	__private float Breg[ WORK_PER_THREAD_N ];
+	__private float acc[ WORK_PER_THREAD_M ][ WORK_PER_THREAD_N ];
+
+	for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+		for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+			acc[ wM ][ wN ] = 0.0f;
+		}
+	}
+
+	// Perform the calculation
+	for ( int tile = 0; tile < N_TILES; tile++ ){
+
+		// Offset variable
+		int TILE_OFFSET = (tile)*(TILE_SIZE_K);
+
+		// Load tile of A: TILE_SIZE_M(rows) x TILE_SIZE_K(cols). Consecutive
+		// threads read consecutive columns of a row (coalesced).
+		for ( int IT = 0; IT < ( TILE_SIZE_M * TILE_SIZE_K ) / N_THREADS; IT++ ){
+
+			int lINDEX = ( IT * N_THREADS ) + LOCAL_ID;
+			int ROW = lINDEX / TILE_SIZE_K;
+			int COL = lINDEX % TILE_SIZE_K;
+
+			int aINDEX = ( ( OFFSET_M + ROW ) * K ) + ( TILE_OFFSET + COL );
+			Asub[ COL ][ ROW ] = ( OFFSET_M + ROW < M && TILE_OFFSET + COL < K ) ? A[ aINDEX ] : 0.0f;
+		}
+
+		// Load tile of B: TILE_SIZE_K(rows) x TILE_SIZE_N(cols)
+		for ( int IT = 0; IT < ( TILE_SIZE_K * TILE_SIZE_N ) / N_THREADS; IT++ ){
+
+			int lINDEX = ( IT * N_THREADS ) + LOCAL_ID;
+			int ROW = lINDEX / TILE_SIZE_N;
+			int COL = lINDEX % TILE_SIZE_N;
+
+			int bINDEX = ( ( TILE_OFFSET + ROW ) * N ) + ( OFFSET_N + COL );
+			Bsub[ ROW ][ COL ] = ( TILE_OFFSET + ROW < K && OFFSET_N + COL < N ) ? B[ bINDEX ] : 0.0f;
+		}
+
+		// Synchronization barrier (load)
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Multiply submatrices. Threads own rows (cols) of the tile strided by 
+		// RTS_M (RTS_N) so that neighbouring threads read neighbouring words.
+		for ( int IT = 0; IT < TILE_SIZE_K; IT++ ){
+
+			// Preload row of Bsub into registers
+			for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+				Breg[ wN ] = Bsub[ IT ][ LOCAL_N + wN * RTS_N ];
+			}
+
+			// Accumulate outer product
+			for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+				Areg = Asub[ IT ][ LOCAL_M + wM * RTS_M ];
+				for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+					acc[ wM ][ wN ] += Areg * Breg[ wN ];
+				}
+			}
+		}
+
+		// Synchronization barrier (product)
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Store the result (inside C only)
+	for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+		for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+
+			int ROW = OFFSET_M + LOCAL_M + wM * RTS_M;
+			int COL = OFFSET_N + LOCAL_N + wN * RTS_N;
+
+			if ( ROW < M && COL < N ){
+				int cINDEX = ( ROW * N ) + COL;
+				float VAL = ( BETA == 0.0f ) ? ALPHA * acc[ wM ][ wN ] : ALPHA * acc[ wM ][ wN ] + BETA * C[ cINDEX ];
+				C[ cINDEX ] = EPILOGUE;
+			}
+		}
 	}
+
+	#undef RTS_M
+	#undef RTS_N
+	#undef N_THREADS
+	#undef TILE_SIZE_M
+	#undef TILE_SIZE_N
+	#undef TILE_SIZE_K
+	#undef WORK_PER_THREAD_M
+	#undef WORK_PER_THREAD_N
+	#undef M
+	#undef N
+	#undef K
+	#undef SHAPE_M
+	#undef SHAPE_N
+	#undef SHAPE_K
+	#undef EPILOGUE
+	#pragma PKP QED
+}
+
+// f32_product_v4: 2D register tiling with vector access (float2/float4/float8)
+//
+// Tiling as in f32_product_v3. Tiles of A and B are read from __global with
+// vloadn (VECTOR_WIDTH floats per load) and each thread accumulates and stores
+// VECTOR_WIDTH contiguous columns of C per vector. Vectors which cross the 
+// edge of a matrix are loaded and stored element by element.
+__kernel void f32_product_v4 (
+		const int M, 
+		const int N, 
+		const int K, 
+		__global float *A, 
+		__global float *B, 
+		__global float *C,
+		const float ALPHA,
+		const float BETA,
+		__global const float *BIAS )
+
+{
+	// Kernel Preprocessor
+	#pragma PKP EPILOGUE __default VAL
+	#ifndef EPILOGUE
+		#define EPILOGUE VAL
+	#endif
+
+	#pragma PKP SHAPE_M __default 0
+	#ifndef SHAPE_M
+		#define SHAPE_M 0
+	#endif
+
+	#pragma PKP SHAPE_N __default 0
+	#ifndef SHAPE_N
+		#define SHAPE_N 0
+	#endif
+
+	#pragma PKP SHAPE_K __default 0
+	#ifndef SHAPE_K
+		#define SHAPE_K 0
+	#endif
+
+	// Shape specialization (see f32_product_v0)
+	#if SHAPE_M
+		#define M SHAPE_M
+	#endif
+	#if SHAPE_N
+		#define N SHAPE_N
+	#endif
+	#if SHAPE_K
+		#define K SHAPE_K
+	#endif
+
+	#pragma PKP TILE_SIZE_M __default 64
+	#ifndef TILE_SIZE_M
+		#define TILE_SIZE_M 64
+	#endif
+
+	#pragma PKP TILE_SIZE_N __default 64
+	#ifndef TILE_SIZE_N
+		#define TILE_SIZE_N 64
+	#endif
+
+	#pragma PKP TILE_SIZE_K __default 16
+	#ifndef TILE_SIZE_K
+		#define TILE_SIZE_K 16
+	#endif
+
+	#pragma PKP WORK_PER_THREAD_M __default 8
+	#ifndef WORK_PER_THREAD_M
+		#define WORK_PER_THREAD_M 8
+	#endif
+
+	#pragma PKP WORK_PER_THREAD_N __default 8
+	#ifndef WORK_PER_THREAD_N
+		#define WORK_PER_THREAD_N 8
+	#endif
+
+	#pragma PKP VECTOR_WIDTH __default 4
+	#ifndef VECTOR_WIDTH
+		#define VECTOR_WIDTH 4
+	#endif
+
+	// Vector type and load/store for VECTOR_WIDTH
+	#if VECTOR_WIDTH == 2
+		#define floatX float2
+		#define vloadX vload2
+		#define vstoreX vstore2
+	#elif VECTOR_WIDTH == 4
+		#define floatX float4
+		#define vloadX vload4
+		#define vstoreX vstore4
+	#elif VECTOR_WIDTH == 8
+		#define floatX float8
+		#define vloadX vload8
+		#define vstoreX vstore8
+	#else
+		#error "f32_product_v4: VECTOR_WIDTH must be 2, 4 or 8"
+	#endif
+
+	// Threads per workgroup (reduced tile size) and vectors per thread (N)
+	#define RTS_M ( TILE_SIZE_M / WORK_PER_THREAD_M )
+	#define RTS_N ( TILE_SIZE_N / WORK_PER_THREAD_N )
+	#define N_THREADS ( RTS_M * RTS_N )
+	#define VPT_N ( WORK_PER_THREAD_N / VECTOR_WIDTH )
+
+	// Tile loads must divide evenly over the workgroup (in vectors)
+	#if ( TILE_SIZE_M % WORK_PER_THREAD_M ) || ( TILE_SIZE_N % WORK_PER_THREAD_N )
+		#error "f32_product_v4: TILE_SIZE_M/N must be multiples of WORK_PER_THREAD_M/N"
+	#endif
+	#if ( TILE_SIZE_K % VECTOR_WIDTH ) || ( WORK_PER_THREAD_N % VECTOR_WIDTH )
+		#error "f32_product_v4: TILE_SIZE_K and WORK_PER_THREAD_N must be multiples of VECTOR_WIDTH"
+	#endif
+	#if ( ( TILE_SIZE_M * TILE_SIZE_K / VECTOR_WIDTH ) % N_THREADS ) || ( ( TILE_SIZE_K * TILE_SIZE_N / VECTOR_WIDTH ) % N_THREADS )
+		#error "f32_product_v4: Tiles of A and B must divide evenly over the workgroup"
+	#endif
+
+	// Thread identifiers (__local)
+	const int LOCAL_M = get_local_id(0);
+	const int LOCAL_N = get_local_id(1);
+	const int LOCAL_ID = ( LOCAL_M * RTS_N ) + LOCAL_N;
+
+	// Tile offsets in C
+	const int OFFSET_M = TILE_SIZE_M * get_group_id(0);
+	const int OFFSET_N = TILE_SIZE_N * get_group_id(1);
+
+	// Number of tiles along K (last tile may be partial)
+	const int N_TILES = ( K + TILE_SIZE_K - 1 ) / TILE_SIZE_K;
+
+	// Local tiles (shared by the workgroup). Asub is stored transposed.
+	__local float Asub[ TILE_SIZE_K ][ TILE_SIZE_M ];
+	__local float Bsub[ TILE_SIZE_K ][ TILE_SIZE_N ];
+
+	// Allocate registers and initialize accumulation buffer
+	__private float Areg;
+	__private float Atmp[ VECTOR_WIDTH ];
+	__private floatX Breg[ VPT_N ];
+	__private floatX acc[ WORK_PER_THREAD_M ][ VPT_N ];
+
+	for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+		for ( int vN = 0; vN < VPT_N; vN++ ){
+			acc[ wM ][ vN ] = (floatX)( 0.0f );
+		}
+	}
+
+	// Perform the calculation
+	for ( int tile = 0; tile < N_TILES; tile++ ){
+
+		// Offset variable
+		int TILE_OFFSET = (tile)*(TILE_SIZE_K);
+
+		// Load tile of A: TILE_SIZE_M(rows) x TILE_SIZE_K(cols) as row vectors,
+		// which are transposed into Asub through private memory
+		for ( int IT = 0; IT < ( TILE_SIZE_M * TILE_SIZE_K / VECTOR_WIDTH ) / N_THREADS; IT++ ){
+
+			int lINDEX = ( IT * N_THREADS ) + LOCAL_ID;
+			int ROW = lINDEX / ( TILE_SIZE_K / VECTOR_WIDTH );
+			int COL = ( lINDEX % ( TILE_SIZE_K / VECTOR_WIDTH ) ) * VECTOR_WIDTH;
+
+			int aINDEX = ( ( OFFSET_M + ROW ) * K ) + ( TILE_OFFSET + COL );
+
+			if ( OFFSET_M + ROW < M && TILE_OFFSET + COL + VECTOR_WIDTH <= K ){
+				vstoreX( vloadX( 0, A + aINDEX ), 0, Atmp );
+			}
+			else {
+				for ( int w = 0; w < VECTOR_WIDTH; w++ ){
+					Atmp[ w ] = ( OFFSET_M + ROW < M && TILE_OFFSET + COL + w < K ) ? A[ aINDEX + w ] : 0.0f;
+				}
+			}
+
+			for ( int w = 0; w < VECTOR_WIDTH; w++ ){
+				Asub[ COL + w ][ ROW ] = Atmp[ w ];
+			}
+		}
+
+		// Load tile of B: TILE_SIZE_K(rows) x TILE_SIZE_N(cols) as row vectors
+		for ( int IT = 0; IT < ( TILE_SIZE_K * TILE_SIZE_N / VECTOR_WIDTH ) / N_THREADS; IT++ ){
+
+			int lINDEX = ( IT * N_THREADS ) + LOCAL_ID;
+			int ROW = lINDEX / ( TILE_SIZE_N / VECTOR_WIDTH );
+			int COL = ( lINDEX % ( TILE_SIZE_N / VECTOR_WIDTH ) ) * VECTOR_WIDTH;
+
+			int bINDEX = ( ( TILE_OFFSET + ROW ) * N ) + ( OFFSET_N + COL );
+
+			if ( TILE_OFFSET + ROW < K && OFFSET_N + COL + VECTOR_WIDTH <= N ){
+				vstoreX( vloadX( 0, B + bINDEX ), 0, &Bsub[ ROW ][ COL ] );
+			}
+			else {
+				for ( int w = 0; w < VECTOR_WIDTH; w++ ){
+					Bsub[ ROW ][ COL + w ] = ( TILE_OFFSET + ROW < K && OFFSET_N + COL + w < N ) ? B[ bINDEX + w ] : 0.0f;
+				}
+			}
+		}
+
+		// Synchronization barrier (load)
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Multiply submatrices. Threads own vectors of the tile strided by RTS_N.
+		for ( int IT = 0; IT < TILE_SIZE_K; IT++ ){
+
+			// Preload row vectors of Bsub into registers
+			for ( int vN = 0; vN < VPT_N; vN++ ){
+				Breg[ vN ] = vloadX( 0, &Bsub[ IT ][ ( vN * RTS_N + LOCAL_N ) * VECTOR_WIDTH ] );
+			}
+
+			// Accumulate outer product
+			for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+				Areg = Asub[ IT ][ LOCAL_M + wM * RTS_M ];
+				for ( int vN = 0; vN < VPT_N; vN++ ){
+					acc[ wM ][ vN ] += Areg * Breg[ vN ];
+				}
+			}
+		}
+
+		// Synchronization barrier (product)
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Store the result (vector stores inside C)
+	for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+		for ( int vN = 0; vN < VPT_N; vN++ ){
+
+			int ROW = OFFSET_M + LOCAL_M + wM * RTS_M;
+			int VCOL = OFFSET_N + ( vN * RTS_N + LOCAL_N ) * VECTOR_WIDTH;
+
+			if ( ROW < M && VCOL + VECTOR_WIDTH <= N ){
+				floatX res = ALPHA * acc[ wM ][ vN ];
+				if ( BETA != 0.0f ){ res += BETA * vloadX( 0, C + ( ROW * N ) + VCOL ); }
+
+				// Epilogue (per element in registers)
+				vstoreX( res, 0, Atmp );
+				for ( int w = 0; w < VECTOR_WIDTH; w++ ){
+					int COL = VCOL + w;
+					float VAL = Atmp[ w ];
+					Atmp[ w ] = EPILOGUE;
+				}
+				vstoreX( vloadX( 0, Atmp ), 0, C + ( ROW * N ) + VCOL );
+			}
+			else if ( ROW < M ){
+				vstoreX( acc[ wM ][ vN ], 0, Atmp );
+				for ( int w = 0; w < VECTOR_WIDTH && VCOL + w < N; w++ ){
+					int COL = VCOL + w;
+					int cINDEX = ( ROW * N ) + COL;
+					float VAL = ( BETA == 0.0f ) ? ALPHA * Atmp[ w ] : ALPHA * Atmp[ w ] + BETA * C[ cINDEX ];
+					C[ cINDEX ] = EPILOGUE;
+				}
+			}
+		}
+	}
+
+	#undef floatX
+	#undef vloadX
+	#undef vstoreX
+	#undef RTS_M
+	#undef RTS_N
+	#undef N_THREADS
+	#undef VPT_N
+	#undef TILE_SIZE_M
+	#undef TILE_SIZE_N
+	#undef TILE_SIZE_K
+	#undef WORK_PER_THREAD_M
+	#undef WORK_PER_THREAD_N
+	#undef VECTOR_WIDTH
+	#undef M
+	#undef N
+	#undef K
+	#undef SHAPE_M
+	#undef SHAPE_N
+	#undef SHAPE_K
+	#undef EPILOGUE
 	#pragma PKP QED
-}
\ No newline at end of file
+}
+
+// f32_product_v5: 2D register tiling on a packed (transposed) B operand
+//
+// B is passed as B^T, N(rows) x K(cols), so that tiles of both operands are 
+// read along contiguous rows of K. Tiling as in f32_product_v3. Partial tiles 
+// are zero padded on load and guarded on store so any M, N and K is valid. 
+// The global range is rounded up to whole tiles.
+__kernel void f32_product_v5 (
+		const int M, 
+		const int N, 
+		const int K, 
+		__global float *A, 
+		__global float *BT, 
+		__global float *C,
+		const float ALPHA,
+		const float BETA,
+		__global const float *BIAS )
+
+{
+	// Kernel Preprocessor
+	#pragma PKP EPILOGUE __default VAL
+	#ifndef EPILOGUE
+		#define EPILOGUE VAL
+	#endif
+
+	#pragma PKP SHAPE_M __default 0
+	#ifndef SHAPE_M
+		#define SHAPE_M 0
+	#endif
+
+	#pragma PKP SHAPE_N __default 0
+	#ifndef SHAPE_N
+		#define SHAPE_N 0
+	#endif
+
+	#pragma PKP SHAPE_K __default 0
+	#ifndef SHAPE_K
+		#define SHAPE_K 0
+	#endif
+
+	// Shape specialization (see f32_product_v0)
+	#if SHAPE_M
+		#define M SHAPE_M
+	#endif
+	#if SHAPE_N
+		#define N SHAPE_N
+	#endif
+	#if SHAPE_K
+		#define K SHAPE_K
+	#endif
+
+	#pragma PKP TILE_SIZE_M __default 64
+	#ifndef TILE_SIZE_M
+		#define TILE_SIZE_M 64
+	#endif
+
+	#pragma PKP TILE_SIZE_N __default 64
+	#ifndef TILE_SIZE_N
+		#define TILE_SIZE_N 64
+	#endif
+
+	#pragma PKP TILE_SIZE_K __default 16
+	#ifndef TILE_SIZE_K
+		#define TILE_SIZE_K 16
+	#endif
+
+	#pragma PKP WORK_PER_THREAD_M __default 8
+	#ifndef WORK_PER_THREAD_M
+		#define WORK_PER_THREAD_M 8
+	#endif
+
+	#pragma PKP WORK_PER_THREAD_N __default 8
+	#ifndef WORK_PER_THREAD_N
+		#define WORK_PER_THREAD_N 8
+	#endif
+
+	// Threads per workgroup (reduced tile size)
+	#define RTS_M ( TILE_SIZE_M / WORK_PER_THREAD_M )
+	#define RTS_N ( TILE_SIZE_N / WORK_PER_THREAD_N )
+	#define N_THREADS ( RTS_M * RTS_N )
+
+	// Tile loads must divide evenly over the workgroup
+	#if ( TILE_SIZE_M % WORK_PER_THREAD_M ) || ( TILE_SIZE_N % WORK_PER_THREAD_N )
+		#error "f32_product_v5: TILE_SIZE_M/N must be multiples of WORK_PER_THREAD_M/N"
+	#endif
+	#if ( ( TILE_SIZE_M * TILE_SIZE_K ) % N_THREADS ) || ( ( TILE_SIZE_N * TILE_SIZE_K ) % N_THREADS )
+		#error "f32_product_v5: Tiles of A and B must divide evenly over the workgroup"
+	#endif
+
+	// Thread identifiers (__local)
+	const int LOCAL_M = get_local_id(0);
+	const int LOCAL_N = get_local_id(1);
+	const int LOCAL_ID = ( LOCAL_M * RTS_N ) + LOCAL_N;
+
+	// Tile offsets in C
+	const int OFFSET_M = TILE_SIZE_M * get_group_id(0);
+	const int OFFSET_N = TILE_SIZE_N * get_group_id(1);
+
+	// Number of tiles along K (last tile may be partial)
+	const int N_TILES = ( K + TILE_SIZE_K - 1 ) / TILE_SIZE_K;
+
+	// Local tiles (shared by the workgroup), both stored transposed
+	__local float Asub[ TILE_SIZE_K ][ TILE_SIZE_M ];
+	__local float Bsub[ TILE_SIZE_K ][ TILE_SIZE_N ];
+
+	// Allocate registers and initialize accumulation buffer
+	__private float Areg;
+	__private float Breg[ WORK_PER_THREAD_N ];
+	__private float acc[ WORK_PER_THREAD_M ][ WORK_PER_THREAD_N ];
+
+	for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+		for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+			acc[ wM ][ wN ] = 0.0f;
+		}
+	}
+
+	// Perform the calculation
+	for ( int tile = 0; tile < N_TILES; tile++ ){
+
+		// Offset variable
+		int TILE_OFFSET = (tile)*(TILE_SIZE_K);
+
+		// Load tile of A: TILE_SIZE_M(rows) x TILE_SIZE_K(cols)
+		for ( int IT = 0; IT < ( TILE_SIZE_M * TILE_SIZE_K ) / N_THREADS; IT++ ){
+
+			int lINDEX = ( IT * N_THREADS ) + LOCAL_ID;
+			int ROW = lINDEX / TILE_SIZE_K;
+			int COL = lINDEX % TILE_SIZE_K;
+
+			int aINDEX = ( ( OFFSET_M + ROW ) * K ) + ( TILE_OFFSET + COL );
+			Asub[ COL ][ ROW ] = ( OFFSET_M + ROW < M && TILE_OFFSET + COL < K ) ? A[ aINDEX ] : 0.0f;
+		}
+
+		// Load tile of B^T: TILE_SIZE_N(rows) x TILE_SIZE_K(cols)
+		for ( int IT = 0; IT < ( TILE_SIZE_N * TILE_SIZE_K ) / N_THREADS; IT++ ){
+
+			int lINDEX = ( IT * N_THREADS ) + LOCAL_ID;
+			int ROW = lINDEX / TILE_SIZE_K;
+			int COL = lINDEX % TILE_SIZE_K;
+
+			int bINDEX = ( ( OFFSET_N + ROW ) * K ) + ( TILE_OFFSET + COL );
+			Bsub[ COL ][ ROW ] = ( OFFSET_N + ROW < N && TILE_OFFSET + COL < K ) ? BT[ bINDEX ] : 0.0f;
+		}
+
+		// Synchronization barrier (load)
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Multiply submatrices
+		for ( int IT = 0; IT < TILE_SIZE_K; IT++ ){
+
+			// Preload row of Bsub into registers
+			for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+				Breg[ wN ] = Bsub[ IT ][ LOCAL_N + wN * RTS_N ];
+			}
+
+			// Accumulate outer product
+			for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+				Areg = Asub[ IT ][ LOCAL_M + wM * RTS_M ];
+				for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+					acc[ wM ][ wN ] += Areg * Breg[ wN ];
+				}
+			}
+		}
+
+		// Synchronization barrier (product)
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Store the result (inside C only)
+	for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+		for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+
+			int ROW = OFFSET_M + LOCAL_M + wM * RTS_M;
+			int COL = OFFSET_N + LOCAL_N + wN * RTS_N;
+
+			if ( ROW < M && COL < N ){
+				int cINDEX = ( ROW * N ) + COL;
+				float VAL = ( BETA == 0.0f ) ? ALPHA * acc[ wM ][ wN ] : ALPHA * acc[ wM ][ wN ] + BETA * C[ cINDEX ];
+				C[ cINDEX ] = EPILOGUE;
+			}
+		}
+	}
+
+	#undef RTS_M
+	#undef RTS_N
+	#undef N_THREADS
+	#undef TILE_SIZE_M
+	#undef TILE_SIZE_N
+	#undef TILE_SIZE_K
+	#undef WORK_PER_THREAD_M
+	#undef WORK_PER_THREAD_N
+	#undef M
+	#undef N
+	#undef K
+	#undef SHAPE_M
+	#undef SHAPE_N
+	#undef SHAPE_K
+	#undef EPILOGUE
+	#pragma PKP QED
+}
+
+// f32_product_v6: 2D register tiling with pipelined (multi-buffered) __local tiles
+//
+// Tiling as in f32_product_v3, but __local memory holds PIPELINE_DEPTH tiles 
+// of A and B. Tile (t + PIPELINE_DEPTH - 1) is fetched from __global while 
+// tile t is multiplied, so global memory latency overlaps with compute and a 
+// single barrier per tile suffices. PIPELINE_DEPTH = 2 is double buffering.
+__kernel void f32_product_v6 (
+		const int M, 
+		const int N, 
+		const int K, 
+		__global float *A, 
+		__global float *B, 
+		__global float *C,
+		const float ALPHA,
+		const float BETA,
+		__global const float *BIAS )
+
+{
+	// Kernel Preprocessor
+	#pragma PKP EPILOGUE __default VAL
+	#ifndef EPILOGUE
+		#define EPILOGUE VAL
+	#endif
+
+	#pragma PKP SHAPE_M __default 0
+	#ifndef SHAPE_M
+		#define SHAPE_M 0
+	#endif
+
+	#pragma PKP SHAPE_N __default 0
+	#ifndef SHAPE_N
+		#define SHAPE_N 0
+	#endif
+
+	#pragma PKP SHAPE_K __default 0
+	#ifndef SHAPE_K
+		#define SHAPE_K 0
+	#endif
+
+	// Shape specialization (see f32_product_v0)
+	#if SHAPE_M
+		#define M SHAPE_M
+	#endif
+	#if SHAPE_N
+		#define N SHAPE_N
+	#endif
+	#if SHAPE_K
+		#define K SHAPE_K
+	#endif
+
+	#pragma PKP TILE_SIZE_M __default 64
+	#ifndef TILE_SIZE_M
+		#define TILE_SIZE_M 64
+	#endif
+
+	#pragma PKP TILE_SIZE_N __default 64
+	#ifndef TILE_SIZE_N
+		#define TILE_SIZE_N 64
+	#endif
+
+	#pragma PKP TILE_SIZE_K __default 16
+	#ifndef TILE_SIZE_K
+		#define TILE_SIZE_K 16
+	#endif
+
+	#pragma PKP WORK_PER_THREAD_M __default 8
+	#ifndef WORK_PER_THREAD_M
+		#define WORK_PER_THREAD_M 8
+	#endif
+
+	#pragma PKP WORK_PER_THREAD_N __default 8
+	#ifndef WORK_PER_THREAD_N
+		#define WORK_PER_THREAD_N 8
+	#endif
+
+	#pragma PKP PIPELINE_DEPTH __default 2
+	#ifndef PIPELINE_DEPTH
+		#define PIPELINE_DEPTH 2
+	#endif
+
+	// Threads per workgroup (reduced tile size)
+	#define RTS_M ( TILE_SIZE_M / WORK_PER_THREAD_M )
+	#define RTS_N ( TILE_SIZE_N / WORK_PER_THREAD_N )
+	#define N_THREADS ( RTS_M * RTS_N )
+
+	// Tile loads must divide evenly over the workgroup
+	#if ( TILE_SIZE_M % WORK_PER_THREAD_M ) || ( TILE_SIZE_N % WORK_PER_THREAD_N )
+		#error "f32_product_v6: TILE_SIZE_M/N must be multiples of WORK_PER_THREAD_M/N"
+	#endif
+	#if ( ( TILE_SIZE_M * TILE_SIZE_K ) % N_THREADS ) || ( ( TILE_SIZE_K * TILE_SIZE_N ) % N_THREADS )
+		#error "f32_product_v6: Tiles of A and B must divide evenly over the workgroup"
+	#endif
+	#if ( PIPELINE_DEPTH < 2 )
+		#error "f32_product_v6: PIPELINE_DEPTH must be at least 2"
+	#endif
+
+	// Thread identifiers (__local)
+	const int LOCAL_M = get_local_id(0);
+	const int LOCAL_N = get_local_id(1);
+	const int LOCAL_ID = ( LOCAL_M * RTS_N ) + LOCAL_N;
+
+	// Tile offsets in C
+	const int OFFSET_M = TILE_SIZE_M * get_group_id(0);
+	const int OFFSET_N = TILE_SIZE_N * get_group_id(1);
+
+	// Number of tiles along K (last tile may be partial)
+	const int N_TILES = ( K + TILE_SIZE_K - 1 ) / TILE_SIZE_K;
+
+	// Local tiles (shared by the workgroup), one per pipeline stage
+	__local float Asub[ PIPELINE_DEPTH ][ TILE_SIZE_K ][ TILE_SIZE_M ];
+	__local float Bsub[ PIPELINE_DEPTH ][ TILE_SIZE_K ][ TILE_SIZE_N ];
+
+	// Allocate registers and initialize accumulation buffer
+	__private float Areg;
+	__private float Breg[ WORK_PER_THREAD_N ];
+	__private float acc[ WORK_PER_THREAD_M ][ WORK_PER_THREAD_N ];
+
+	for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+		for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+			acc[ wM ][ wN ] = 0.0f;
+		}
+	}
+
+	// Perform the calculation. Iterations before the first tile fill the pipeline.
+	for ( int tile = 1 - PIPELINE_DEPTH; tile < N_TILES; tile++ ){
+
+		// Prefetch tile (tile + PIPELINE_DEPTH - 1) into its stage
+		int FETCH = tile + PIPELINE_DEPTH - 1;
+
+		if ( FETCH < N_TILES ){
+
+			int STAGE = FETCH % PIPELINE_DEPTH;
+			int TILE_OFFSET = (FETCH)*(TILE_SIZE_K);
+
+			// Load tile of A: TILE_SIZE_M(rows) x TILE_SIZE_K(cols)
+			for ( int IT = 0; IT < ( TILE_SIZE_M * TILE_SIZE_K ) / N_THREADS; IT++ ){
+
+				int lINDEX = ( IT * N_THREADS ) + LOCAL_ID;
+				int ROW = lINDEX / TILE_SIZE_K;
+				int COL = lINDEX % TILE_SIZE_K;
+
+				int aINDEX = ( ( OFFSET_M + ROW ) * K ) + ( TILE_OFFSET + COL );
+				Asub[ STAGE ][ COL ][ ROW ] = ( OFFSET_M + ROW < M && TILE_OFFSET + COL < K ) ? A[ aINDEX ] : 0.0f;
+			}
+
+			// Load tile of B: TILE_SIZE_K(rows) x TILE_SIZE_N(cols)
+			for ( int IT = 0; IT < ( TILE_SIZE_K * TILE_SIZE_N ) / N_THREADS; IT++ ){
+
+				int lINDEX = ( IT * N_THREADS ) + LOCAL_ID;
+				int ROW = lINDEX / TILE_SIZE_N;
+				int COL = lINDEX % TILE_SIZE_N;
+
+				int bINDEX = ( ( TILE_OFFSET + ROW ) * N ) + ( OFFSET_N + COL );
+				Bsub[ STAGE ][ ROW ][ COL ] = ( TILE_OFFSET + ROW < K && OFFSET_N + COL < N ) ? B[ bINDEX ] : 0.0f;
+			}
+		}
+
+		// Multiply submatrices of the current stage (loaded at least one barrier ago)
+		if ( tile >= 0 ){
+
+			int STAGE = tile % PIPELINE_DEPTH;
+
+			for ( int IT = 0; IT < TILE_SIZE_K; IT++ ){
+
+				// Preload row of Bsub into registers
+				for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+					Breg[ wN ] = Bsub[ STAGE ][ IT ][ LOCAL_N + wN * RTS_N ];
+				}
+
+				// Accumulate outer product
+				for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+					Areg = Asub[ STAGE ][ IT ][ LOCAL_M + wM * RTS_M ];
+					for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+						acc[ wM ][ wN ] += Areg * Breg[ wN ];
+					}
+				}
+			}
+		}
+
+		// Synchronization barrier (the stage read here is refilled next iteration)
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Store the result (inside C only)
+	for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+		for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+
+			int ROW = OFFSET_M + LOCAL_M + wM * RTS_M;
+			int COL = OFFSET_N + LOCAL_N + wN * RTS_N;
+
+			if ( ROW < M && COL < N ){
+				int cINDEX = ( ROW * N ) + COL;
+				float VAL = ( BETA == 0.0f ) ? ALPHA * acc[ wM ][ wN ] : ALPHA * acc[ wM ][ wN ] + BETA * C[ cINDEX ];
+				C[ cINDEX ] = EPILOGUE;
+			}
+		}
+	}
+
+	#undef RTS_M
+	#undef RTS_N
+	#undef N_THREADS
+	#undef TILE_SIZE_M
+	#undef TILE_SIZE_N
+	#undef TILE_SIZE_K
+	#undef WORK_PER_THREAD_M
+	#undef WORK_PER_THREAD_N
+	#undef PIPELINE_DEPTH
+	#undef M
+	#undef N
+	#undef K
+	#undef SHAPE_M
+	#undef SHAPE_N
+	#undef SHAPE_K
+	#undef EPILOGUE
+	#pragma PKP QED
+}
+
+// f32_product_v7: 2D register tiling with padded __local tiles (host allocated)
+//
+// Tiling as in f32_product_v3 with independent TILE_SIZE_M/N/K. The __local
+// tiles are passed as arguments and sized by the host from the PKP constants
+// (not from the NDRange). Rows of the tiles are padded by LOCAL_PAD words so 
+// that power-of-two tile widths do not map the transposed stores of A (and 
+// strided accesses in general) onto a single local memory bank.
+//
+// Asub: TILE_SIZE_K x ( TILE_SIZE_M + LOCAL_PAD )
+// Bsub: TILE_SIZE_K x ( TILE_SIZE_N + LOCAL_PAD )
+__kernel void f32_product_v7 (
+		const int M, 
+		const int N, 
+		const int K, 
+		__global float *A, 
+		__global float *B, 
+		__global float *C,
+		const float ALPHA,
+		const float BETA,
+		__global const float *BIAS,
+		__local float *Asub,
+		__local float *Bsub )
+
+{
+	// Kernel Preprocessor
+	#pragma PKP EPILOGUE __default VAL
+	#ifndef EPILOGUE
+		#define EPILOGUE VAL
+	#endif
+
+	#pragma PKP SHAPE_M __default 0
+	#ifndef SHAPE_M
+		#define SHAPE_M 0
+	#endif
+
+	#pragma PKP SHAPE_N __default 0
+	#ifndef SHAPE_N
+		#define SHAPE_N 0
+	#endif
+
+	#pragma PKP SHAPE_K __default 0
+	#ifndef SHAPE_K
+		#define SHAPE_K 0
+	#endif
+
+	// Shape specialization (see f32_product_v0)
+	#if SHAPE_M
+		#define M SHAPE_M
+	#endif
+	#if SHAPE_N
+		#define N SHAPE_N
+	#endif
+	#if SHAPE_K
+		#define K SHAPE_K
+	#endif
+
+	#pragma PKP TILE_SIZE_M __default 64
+	#ifndef TILE_SIZE_M
+		#define TILE_SIZE_M 64
+	#endif
+
+	#pragma PKP TILE_SIZE_N __default 64
+	#ifndef TILE_SIZE_N
+		#define TILE_SIZE_N 64
+	#endif
+
+	#pragma PKP TILE_SIZE_K __default 16
+	#ifndef TILE_SIZE_K
+		#define TILE_SIZE_K 16
+	#endif
+
+	#pragma PKP WORK_PER_THREAD_M __default 8
+	#ifndef WORK_PER_THREAD_M
+		#define WORK_PER_THREAD_M 8
+	#endif
+
+	#pragma PKP WORK_PER_THREAD_N __default 8
+	#ifndef WORK_PER_THREAD_N
+		#define WORK_PER_THREAD_N 8
+	#endif
+
+	#pragma PKP LOCAL_PAD __default 1
+	#ifndef LOCAL_PAD
+		#define LOCAL_PAD 1
+	#endif
+
+	// Threads per workgroup (reduced tile size)
+	#define RTS_M ( TILE_SIZE_M / WORK_PER_THREAD_M )
+	#define RTS_N ( TILE_SIZE_N / WORK_PER_THREAD_N )
+	#define N_THREADS ( RTS_M * RTS_N )
+
+	// Padded tile indexing (k, m) and (k, n)
+	#define ASUB(k, m) Asub[ (k) * ( TILE_SIZE_M + LOCAL_PAD ) + (m) ]
+	#define BSUB(k, n) Bsub[ (k) * ( TILE_SIZE_N + LOCAL_PAD ) + (n) ]
+
+	// Tile loads must divide evenly over the workgroup
+	#if ( TILE_SIZE_M % WORK_PER_THREAD_M ) || ( TILE_SIZE_N % WORK_PER_THREAD_N )
+		#error "f32_product_v7: TILE_SIZE_M/N must be multiples of WORK_PER_THREAD_M/N"
+	#endif
+	#if ( ( TILE_SIZE_M * TILE_SIZE_K ) % N_THREADS ) || ( ( TILE_SIZE_K * TILE_SIZE_N ) % N_THREADS )
+		#error "f32_product_v7: Tiles of A and B must divide evenly over the workgroup"
+	#endif
+
+	// Thread identifiers (__local)
+	const int LOCAL_M = get_local_id(0);
+	const int LOCAL_N = get_local_id(1);
+	const int LOCAL_ID = ( LOCAL_M * RTS_N ) + LOCAL_N;
+
+	// Tile offsets in C
+	const int OFFSET_M = TILE_SIZE_M * get_group_id(0);
+	const int OFFSET_N = TILE_SIZE_N * get_group_id(1);
+
+	// Number of tiles along K (last tile may be partial)
+	const int N_TILES = ( K + TILE_SIZE_K - 1 ) / TILE_SIZE_K;
+
+	// Allocate registers and initialize accumulation buffer
+	__private float Areg;
+	__private float Breg[ WORK_PER_THREAD_N ];
+	__private float acc[ WORK_PER_THREAD_M ][ WORK_PER_THREAD_N ];
+
+	for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+		for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+			acc[ wM ][ wN ] = 0.0f;
+		}
+	}
+
+	// Perform the calculation
+	for ( int tile = 0; tile < N_TILES; tile++ ){
+
+		// Offset variable
+		int TILE_OFFSET = (tile)*(TILE_SIZE_K);
+
+		// Load tile of A: TILE_SIZE_M(rows) x TILE_SIZE_K(cols), stored transposed
+		for ( int IT = 0; IT < ( TILE_SIZE_M * TILE_SIZE_K ) / N_THREADS; IT++ ){
+
+			int lINDEX = ( IT * N_THREADS ) + LOCAL_ID;
+			int ROW = lINDEX / TILE_SIZE_K;
+			int COL = lINDEX % TILE_SIZE_K;
+
+			int aINDEX = ( ( OFFSET_M + ROW ) * K ) + ( TILE_OFFSET + COL );
+			ASUB( COL, ROW ) = ( OFFSET_M + ROW < M && TILE_OFFSET + COL < K ) ? A[ aINDEX ] : 0.0f;
+		}
+
+		// Load tile of B: TILE_SIZE_K(rows) x TILE_SIZE_N(cols)
+		for ( int IT = 0; IT < ( TILE_SIZE_K * TILE_SIZE_N ) / N_THREADS; IT++ ){
+
+			int lINDEX = ( IT * N_THREADS ) + LOCAL_ID;
+			int ROW = lINDEX / TILE_SIZE_N;
+			int COL = lINDEX % TILE_SIZE_N;
+
+			int bINDEX = ( ( TILE_OFFSET + ROW ) * N ) + ( OFFSET_N + COL );
+			BSUB( ROW, COL ) = ( TILE_OFFSET + ROW < K && OFFSET_N + COL < N ) ? B[ bINDEX ] : 0.0f;
+		}
+
+		// Synchronization barrier (load)
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Multiply submatrices
+		for ( int IT = 0; IT < TILE_SIZE_K; IT++ ){
+
+			// Preload row of Bsub into registers
+			for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+				Breg[ wN ] = BSUB( IT, LOCAL_N + wN * RTS_N );
+			}
+
+			// Accumulate outer product
+			for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+				Areg = ASUB( IT, LOCAL_M + wM * RTS_M );
+				for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+					acc[ wM ][ wN ] += Areg * Breg[ wN ];
+				}
+			}
+		}
+
+		// Synchronization barrier (product)
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Store the result (inside C only)
+	for ( int wM = 0; wM < WORK_PER_THREAD_M; wM++ ){
+		for ( int wN = 0; wN < WORK_PER_THREAD_N; wN++ ){
+
+			int ROW = OFFSET_M + LOCAL_M + wM * RTS_M;
+			int COL = OFFSET_N + LOCAL_N + wN * RTS_N;
+
+			if ( ROW < M && COL < N ){
+				int cINDEX = ( ROW * N ) + COL;
+				float VAL = ( BETA == 0.0f ) ? ALPHA * acc[ wM ][ wN ] : ALPHA * acc[ wM ][ wN ] + BETA * C[ cINDEX ];
+				C[ cINDEX ] = EPILOGUE;
+			}
+		}
+	}
+
+	#undef ASUB
+	#undef BSUB
+	#undef RTS_M
+	#undef RTS_N
+	#undef N_THREADS
+	#undef TILE_SIZE_M
+	#undef TILE_SIZE_N
+	#undef TILE_SIZE_K
+	#undef WORK_PER_THREAD_M
+	#undef WORK_PER_THREAD_N
+	#undef LOCAL_PAD
+	#undef M
+	#undef N
+	#undef K
+	#undef SHAPE_M
+	#undef SHAPE_N
+	#undef SHAPE_K
+	#undef EPILOGUE
+	#pragma PKP QED
+}
+
+// f32_product_v8: split-K (small C, large K)
+//
+// K is partitioned into SPLITS slices (chosen by the host from the number of
+// compute units) and each workgroup computes a TILE_SIZE x TILE_SIZE tile of C 
+// over one slice (NDRange dimension 2), so that M*N / TILE_SIZE^2 tiles still 
+// occupy the device. The kernel runs in two passes (PASS):
+//
+//	0: partial tiles are written to PARTIAL, SPLITS x m(rows) x n(cols)
+//	1: partial tiles are summed in slice order (one thread per element of C)
+//	   and ALPHA, BETA and EPILOGUE are applied
+//
+// Dimension 0 of the NDRange runs along N, so that loads of A and B and the 
+// stores of both passes are coalesced. Pass 1 runs on dimensions 0 and 1 only.
+__kernel void f32_product_v8 (
+		const int M, 
+		const int N, 
+		const int K, 
+		__global float *A, 
+		__global float *B, 
+		__global float *C,
+		const float ALPHA,
+		const float BETA,
+		__global const float *BIAS,
+		__global float *PARTIAL,
+		const int SPLITS,
+		const int PASS )
+
+{
+	// Kernel Preprocessor
+	#pragma PKP EPILOGUE __default VAL
+	#ifndef EPILOGUE
+		#define EPILOGUE VAL
+	#endif
+
+	#pragma PKP SHAPE_M __default 0
+	#ifndef SHAPE_M
+		#define SHAPE_M 0
+	#endif
+
+	#pragma PKP SHAPE_N __default 0
+	#ifndef SHAPE_N
+		#define SHAPE_N 0
+	#endif
+
+	#pragma PKP SHAPE_K __default 0
+	#ifndef SHAPE_K
+		#define SHAPE_K 0
+	#endif
+
+	// Shape specialization (see f32_product_v0)
+	#if SHAPE_M
+		#define M SHAPE_M
+	#endif
+	#if SHAPE_N
+		#define N SHAPE_N
+	#endif
+	#if SHAPE_K
+		#define K SHAPE_K
+	#endif
+
+	#pragma PKP TILE_SIZE __default 16
+	#ifndef TILE_SIZE
+		#define TILE_SIZE 16
+	#endif
+
+	// Thread identifiers (__global)
+	const int GLOBAL_N = get_global_id(0);
+	const int GLOBAL_M = get_global_id(1);
+
+	// Index of C (and of each partial tile)
+	const long gINDEX = ( (long)GLOBAL_M * N ) + GLOBAL_N;
+	const long SLICE = (long)M * N;
+
+	// Pass 1: reduce partial tiles
+	if ( PASS == 1 ){
+
+		// Threads outside of C (rounded global range)
+		if ( GLOBAL_M >= M || GLOBAL_N >= N ){ return; }
+
+		float acc = 0.0f;
+		for ( int S = 0; S < SPLITS; S++ ){
+			acc += PARTIAL[ S * SLICE + gINDEX ];
+		}
+
+		// Store result
+		int COL = GLOBAL_N;
+		float VAL = ( BETA == 0.0f ) ? ALPHA * acc : ALPHA * acc + BETA * C[ gINDEX ];
+		C[ gINDEX ] = EPILOGUE;
+		return;
+	}
+
+	// Thread identifiers (__local)
+	const int LOCAL_N = get_local_id(0);
+	const int LOCAL_M = get_local_id(1);
+
+	// Slice of K (whole tiles, the last slices may be partial or empty)
+	const int SPLIT = get_global_id(2);
+	const int K_SLICE = ( ( K + SPLITS * TILE_SIZE - 1 ) / ( SPLITS * TILE_SIZE ) ) * TILE_SIZE;
+	const int K_BEGIN = SPLIT * K_SLICE;
+	const int K_END = min( K, K_BEGIN + K_SLICE );
+
+	// Local tiles (shared by the workgroup)
+	__local float Asub[ TILE_SIZE ][ TILE_SIZE ];
+	__local float Bsub[ TILE_SIZE ][ TILE_SIZE ];
+
+	// Initialize accumulation buffer
+	float acc = 0.0f;
+
+	// Perform the calculation
+	for ( int TILE_OFFSET = K_BEGIN; TILE_OFFSET < K_END; TILE_OFFSET += TILE_SIZE ){
+
+		// Load tiles of A and B (zero padded outside of the matrices and slice)
+		int aCOL = TILE_OFFSET + LOCAL_N;
+		int bROW = TILE_OFFSET + LOCAL_M;
+
+		Asub[ LOCAL_M ][ LOCAL_N ] = ( GLOBAL_M < M && aCOL < K_END ) ? A[ ( GLOBAL_M * K ) + aCOL ] : 0.0f;
+		Bsub[ LOCAL_M ][ LOCAL_N ] = ( bROW < K_END && GLOBAL_N < N ) ? B[ ( bROW * N ) + GLOBAL_N ] : 0.0f;
+
+		// Synchronization barrier (load)
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Multiply submatrices
+		for ( int IT = 0; IT < TILE_SIZE; IT++ ){
+			acc += Asub[ LOCAL_M ][ IT ] * Bsub[ IT ][ LOCAL_N ];
+		}
+
+		// Synchronization barrier (compute)
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Store partial tile
+	if ( GLOBAL_M < M && GLOBAL_N < N ){
+		PARTIAL[ SPLIT * SLICE + gINDEX ] = acc;
+	}
+
+	#undef TILE_SIZE
+	#undef M
+	#undef N
+	#undef K
+	#undef SHAPE_M
+	#undef SHAPE_N
+	#undef SHAPE_K
+	#undef EPILOGUE
+	#pragma PKP QED
+}
@@ -81,4 +81,72 @@ __kernel void f32_show_threads(
 	printf("(index = %d)\n\t| g(%d, %d)\n\t| b(%d, %d)\n\t| l(%d, %d)\n", 
 		gINDEX, GLOBAL_M, GLOBAL_N, BLOCK_M, BLOCK_N, LOCAL_M, LOCAL_N );
 
+}
+
+// f32_add: elementwise sum C = A + B
+__kernel void f32_add(
+	const int SIZE,
+	__global const float *A,
+	__global const float *B,
+	__global float *C )
+
+{
+	// Thread identifier (__global)
+	const int gINDEX = get_global_id(0);
+
+	// Store result
+	if ( gINDEX < SIZE ){
+		C[ gINDEX ] = A[ gINDEX ] + B[ gINDEX ];
+	}
+}
+
+// f32_sub: elementwise difference C = A - B
+__kernel void f32_sub(
+	const int SIZE,
+	__global const float *A,
+	__global const float *B,
+	__global float *C )
+
+{
+	// Thread identifier (__global)
+	const int gINDEX = get_global_id(0);
+
+	// Store result
+	if ( gINDEX < SIZE ){
+		C[ gINDEX ] = A[ gINDEX ] - B[ gINDEX ];
+	}
+}
+
+// f32_dot: elementwise product C = A .* B
+__kernel void f32_dot(
+	const int SIZE,
+	__global const float *A,
+	__global const float *B,
+	__global float *C )
+
+{
+	// Thread identifier (__global)
+	const int gINDEX = get_global_id(0);
+
+	// Store result
+	if ( gINDEX < SIZE ){
+		C[ gINDEX ] = A[ gINDEX ] * B[ gINDEX ];
+	}
+}
+
+// f32_scale: scalar multiplication C = alpha * A
+__kernel void f32_scale(
+	const int SIZE,
+	const float alpha,
+	__global const float *A,
+	__global float *C )
+
+{
+	// Thread identifier (__global)
+	const int gINDEX = get_global_id(0);
+
+	// Store result
+	if ( gINDEX < SIZE ){
+		C[ gINDEX ] = alpha * A[ gINDEX ];
+	}
 }
\ No newline at end of file
@@ -0,0 +1,214 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> lib/interface/cl_build.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+// Standard libraries
+#include <map>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <future>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+// Build failure. Builds which do not report errors themselves throw this (see
+// cl_device::build_program), so that failures of background builds reach the
+// thread which requests the program.
+struct cl_build_error {
+	cl_int err;
+	std::string what;
+	std::string log;
+};
+
+// Lazy program builds. Each program is identified by a key and built once,
+// either by the first thread which requests it (get) or in the background by
+// one of the worker threads (warm). A request for a program which is being
+// built in the background waits for that build, while a request for a program
+// which is only queued builds it immediately, so a caller never waits on
+// builds of other programs.
+//
+// Exceptions thrown by a build are rethrown by get() for that program. Pending
+// background builds are dropped when the queue is destroyed (builds in progress
+// are completed).
+class cl_build_queue {
+
+	public:
+
+		// Build function (returns built program)
+		typedef std::function<cl::Program(void)> cl_build_fn;
+
+		// Constructors (threads = 0 disables background builds)
+		cl_build_queue(size_t threads = 2);
+		~cl_build_queue(void);
+
+		// Program for key (built by the calling thread unless already claimed)
+		cl::Program get(const std::string& key, const cl_build_fn& build);
+
+		// Queue program for a background build
+		void warm(const std::string& key, const cl_build_fn& build);
+
+		// Drop programs (and pending builds) not listed in keys
+		void retain(const std::set<std::string>& keys);
+
+		// Programs built or being built
+		size_t size(void);
+
+	private:
+
+		// Programs by key (claimed builds)
+		std::map<std::string, std::shared_future<cl::Program>> programs;
+
+		// Pending background builds
+		std::deque<std::pair<std::string, cl_build_fn>> pending;
+
+		// Worker threads and synchronization
+		std::vector<std::thread> workers;
+		std::mutex lock;
+		std::condition_variable wake;
+		bool stop;
+
+		// Claim build of key (NULL if already claimed). Call with lock held.
+		std::shared_ptr<std::packaged_task<cl::Program(void)>> claim(const std::string& key, const cl_build_fn& build);
+
+		// Worker loop
+		void worker(void);
+};
+
+// Constructor
+cl_build_queue::cl_build_queue(size_t threads){
+
+	this->stop = false;
+	for (size_t i = 0; i < threads; i++){
+		this->workers.push_back( std::thread(&cl_build_queue::worker, this) );
+	}
+}
+
+// Destructor (drop pending builds and join workers)
+cl_build_queue::~cl_build_queue(void){
+
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->stop = true;
+		this->pending.clear();
+	}
+	this->wake.notify_all();
+
+	for (std::thread& t : this->workers){
+		t.join();
+	}
+}
+
+// Claim build of key
+std::shared_ptr<std::packaged_task<cl::Program(void)>> cl_build_queue::claim(const std::string& key, const cl_build_fn& build){
+
+	if ( this->programs.find( key ) != this->programs.end() ){
+		return NULL;
+	}
+
+	std::shared_ptr<std::packaged_task<cl::Program(void)>> task =
+		std::make_shared<std::packaged_task<cl::Program(void)>>( build );
+	this->programs[ key ] = task->get_future().share();
+	return task;
+}
+
+// Program for key
+cl::Program cl_build_queue::get(const std::string& key, const cl_build_fn& build){
+
+	std::shared_ptr<std::packaged_task<cl::Program(void)>> task;
+	std::shared_future<cl::Program> program;
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		task = this->claim(key, build);
+		program = this->programs[ key ];
+	}
+
+	// Build in calling thread
+	if ( task ){
+		(*task)();
+	}
+	return program.get();
+}
+
+// Queue program for a background build
+void cl_build_queue::warm(const std::string& key, const cl_build_fn& build){
+
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		if ( this->workers.empty() || this->programs.find( key ) != this->programs.end() ){
+			return;
+		}
+		this->pending.push_back( std::make_pair( key, build ) );
+	}
+	this->wake.notify_one();
+}
+
+// Drop programs not listed in keys (e.g. kernels whose sources have changed). 
+// Builds in progress complete but their programs are released.
+void cl_build_queue::retain(const std::set<std::string>& keys){
+
+	std::lock_guard<std::mutex> guard(this->lock);
+
+	for ( auto it = this->programs.begin(); it != this->programs.end(); ){
+		it = ( keys.count( it->first ) == 0 ) ? this->programs.erase( it ) : std::next( it );
+	}
+	for ( auto it = this->pending.begin(); it != this->pending.end(); ){
+		it = ( keys.count( it->first ) == 0 ) ? this->pending.erase( it ) : std::next( it );
+	}
+}
+
+// Programs built or being built
+size_t cl_build_queue::size(void){
+
+	std::lock_guard<std::mutex> guard(this->lock);
+	return this->programs.size();
+}
+
+// Worker loop: claim pending builds which have not been requested meanwhile
+void cl_build_queue::worker(void){
+
+	while (true){
+
+		std::shared_ptr<std::packaged_task<cl::Program(void)>> task;
+		{
+			std::unique_lock<std::mutex> guard(this->lock);
+			this->wake.wait(guard, [&]{ return this->stop || !this->pending.empty(); });
+			if ( this->stop ){
+				return;
+			}
+
+			std::pair<std::string, cl_build_fn> job = this->pending.front();
+			this->pending.pop_front();
+			task = this->claim(job.first, job.second);
+		}
+
+		if ( task ){
+			(*task)();
+		}
+	}
+}
@@ -0,0 +1,188 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> lib/interface/cl_cache.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+// Standard libraries
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+// POSIX (mkdir, getpid)
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// Program binary cache. Compiled program binaries (CL_PROGRAM_BINARIES) are
+// stored on disk under a 64-bit FNV-1a hash of the PKP digest, device name,
+// driver version and build options. The cache directory is resolved from:
+//
+//	$AURORACL_CACHE_DIR
+//	$XDG_CACHE_HOME/auroraCL
+//	$HOME/.cache/auroraCL
+//
+// If none of these are available the cache is disabled.
+class cl_binary_cache {
+
+	public:
+
+		// Cache directory (empty if disabled)
+		std::string cache_dir;
+
+		// Constructors
+		cl_binary_cache(void);
+		~cl_binary_cache(void);
+
+		// Calculate cache key
+		std::string key(
+			const std::string& digest,
+			const std::string& device_name,
+			const std::string& driver_version,
+			const std::string& build_options
+		);
+
+		// Load/store binaries for key
+		bool load(const std::string& key, std::vector<unsigned char>& binary);
+		void store(const std::string& key, const std::vector<unsigned char>& binary);
+
+		// Create directory (and parents)
+		bool make_dir(const std::string& dir);
+
+	private:
+
+		// Path to binary for key
+		std::string path(const std::string& key);
+};
+
+// Constructor (resolve cache directory)
+cl_binary_cache::cl_binary_cache(void){
+
+	const char* env_dir = std::getenv("AURORACL_CACHE_DIR");
+	const char* xdg_dir = std::getenv("XDG_CACHE_HOME");
+	const char* home    = std::getenv("HOME");
+
+	if ( env_dir && *env_dir ){
+		this->cache_dir = std::string(env_dir);
+	}
+	else if ( xdg_dir && *xdg_dir ){
+		this->cache_dir = std::string(xdg_dir) + "/auroraCL";
+	}
+	else if ( home && *home ){
+		this->cache_dir = std::string(home) + "/.cache/auroraCL";
+	}
+}
+
+// Destructor
+cl_binary_cache::~cl_binary_cache(void) { }
+
+// 64-bit FNV-1a hash of build inputs
+std::string cl_binary_cache::key(
+	const std::string& digest,
+	const std::string& device_name,
+	const std::string& driver_version,
+	const std::string& build_options ){
+
+	unsigned long long hash = 14695981039346656037ULL;
+	for ( const std::string* s : { &digest, &device_name, &driver_version, &build_options } ){
+
+		for ( unsigned char c : *s ){
+			hash ^= c;
+			hash *= 1099511628211ULL;
+		}
+
+		// Field separator
+		hash ^= 0xff;
+		hash *= 1099511628211ULL;
+	}
+
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%016llx", hash);
+	return std::string(buffer);
+}
+
+// Path to binary for key
+std::string cl_binary_cache::path(const std::string& key){
+	return this->cache_dir + "/" + key + ".bin";
+}
+
+// Load binary from cache
+bool cl_binary_cache::load(const std::string& key, std::vector<unsigned char>& binary){
+
+	if ( this->cache_dir.empty() ){
+		return false;
+	}
+
+	std::ifstream f( this->path(key).c_str(), std::ios::in | std::ios::binary );
+	if ( !f.is_open() ){
+		return false;
+	}
+
+	binary.assign( std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>() );
+	return !binary.empty();
+}
+
+// Store binary in cache. Written to a temporary file and renamed so that
+// concurrent processes never observe a partial binary.
+void cl_binary_cache::store(const std::string& key, const std::vector<unsigned char>& binary){
+
+	if ( this->cache_dir.empty() || binary.empty() || !this->make_dir(this->cache_dir) ){
+		return;
+	}
+
+	std::string tmp = this->path(key) + "." + std::to_string( getpid() ) + ".tmp";
+	std::ofstream f( tmp.c_str(), std::ios::out | std::ios::binary );
+	if ( !f.is_open() ){
+		return;
+	}
+
+	f.write( (const char*)&binary[0], binary.size() );
+	f.close();
+
+	if ( f.fail() || std::rename( tmp.c_str(), this->path(key).c_str() ) != 0 ){
+		std::remove( tmp.c_str() );
+	}
+}
+
+// Create directory and parents (mkdir -p)
+bool cl_binary_cache::make_dir(const std::string& dir){
+
+	struct stat st;
+	if ( stat( dir.c_str(), &st ) == 0 ){
+		return S_ISDIR( st.st_mode );
+	}
+
+	size_t pos = dir.find_last_of('/');
+	if ( pos != std::string::npos && pos > 0 ){
+		this->make_dir( dir.substr(0, pos) );
+	}
+
+	// Directory may have been created concurrently
+	if ( mkdir( dir.c_str(), 0755 ) == 0 ){
+		return true;
+	}
+	return ( stat( dir.c_str(), &st ) == 0 && S_ISDIR( st.st_mode ) );
+}
\ No newline at end of file
@@ -32,6 +32,12 @@
 #include <iostream>
 #include <streambuf>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <list>
+#include <map>
+#include <set>
 
 // Include OpenCL.
 #include <CL/cl2.hpp>
@@ -39,6 +45,18 @@
 // Include kernel pre-processor
 #include "../pkp/cl_pkp.cpp"
 
+// Include buffer pool
+#include "./cl_pool.cpp"
+
+// Include program binary cache
+#include "./cl_cache.cpp"
+
+// Include kernel tuning database
+#include "./cl_tuning.cpp"
+
+// Include lazy program builds
+#include "./cl_build.cpp"
+
 class cl_device {
 
 	public:
@@ -50,6 +68,66 @@ class cl_device {
 		cl_pkp kernels;
 		cl::Program program;  
 
+		// Program build options and on-disk binary cache
+		std::string build_options;
+		bool cache_binaries = true;
+		cl_binary_cache binary_cache;
+
+		// Program binaries embedded with the kernel sources (if any)
+		const cl_embedded_binary* embedded_binaries = NULL;
+		size_t n_embedded_binaries = 0;
+
+		// Lazy builds. If set then build_sources() does not build the digest:
+		// each kernel is built into a program of its own when it is first 
+		// requested, while build_threads background threads build the rest.
+		bool lazy_build = false;
+		size_t build_threads = 2;
+		std::shared_ptr<cl_build_queue> build_queue;
+		std::shared_ptr<cl_device> builder;
+
+		// Autotuned product kernel launches (loaded for this device)
+		cl_tuning_db tuning;
+
+		// Buffer pool (shared between copies of the device)
+		std::shared_ptr<cl_buffer_pool> pool;
+
+		// Persistent (in-order) command queue
+		cl::CommandQueue queue;
+
+		// Zero-copy host buffers (CL_MEM_USE_HOST_PTR). Enabled by default
+		// when the device shares physical memory with the host.
+		bool host_unified = false;
+		bool zero_copy = false;
+
+		// __local memory per workgroup (bytes) for sizing kernel tiles
+		size_t local_mem_size = 0;
+
+		// Threads per workgroup (launch limit)
+		size_t max_work_group_size = 0;
+
+		// Compute units (occupancy heuristics for kernel selection)
+		size_t compute_units = 0;
+
+		// Kernel object cache. cl::Kernel arguments are not thread safe 
+		// so kernels are cached per (thread, kernel name)
+		typedef std::pair<std::thread::id, std::string> cl_kernel_key;
+		std::map<cl_kernel_key, cl::Kernel> kernel_cache;
+		std::shared_ptr<std::mutex> kernel_lock;
+
+		// Kernel variants (epilogues, tuned and shape specialized). Each is 
+		// built into a program of its own, and at most specialize_capacity 
+		// variants are kept (least recently used are evicted along with their
+		// PKP source). If nonzero, a launch shape is specialized once it has 
+		// been seen specialize_after times. The variant is built by the 
+		// launching thread, so this is off by default (builds stall the 
+		// launch which triggers them).
+		size_t specialize_after = 0;
+		size_t specialize_capacity = 16;
+
+		std::map<std::string, cl::Program> specialized;
+		std::list<std::string> specialized_lru;
+		std::map<std::string, size_t> launch_count;
+
 		// Constructors
 		cl_device(cl::Device);
 		cl_device(void);
@@ -60,18 +138,45 @@ class cl_device {
 
 		// Build sources method
 		void kernel_source(const char*);
+		void kernel_source(const cl_embedded_source&);
 		void build_sources(void);
+		cl::Program build_program(const std::string&, bool report = true);
+		void build_error(const cl_build_error&);
 
-		// Get (compiled) kernel object 
+		// Get (compiled) kernel object and the program containing it
 		cl::Kernel get_kernel(const char*);
+		cl::Program get_program(const std::string&);
+
+		// PKP lookups (safe while other threads add variants)
+		bool has_kernel(const std::string&);
+		std::string get_base(const std::string&);
+		std::map<std::string, std::string> get_config(const std::string&);
+		std::string get_config(const std::string&, const std::string&);
+
+		// Get (compiled) variant of a kernel with updated pkp values
+		std::string get_variant(std::string, std::map<std::string, std::string>, bool report = true);
+
+		// Get (compiled) variant in a program of its own (LRU cache)
+		std::string get_specialized(std::string, std::map<std::string, std::string>, bool report = true);
+
+		// Get variant for a launch shape if the shape is hot (kernel otherwise)
+		std::string get_specialized(std::string, size_t, size_t, size_t);
+
+		// Get pooled buffer (returned to pool when last reference drops)
+		std::shared_ptr<cl::Buffer> get_buffer(cl_mem_flags, size_t);
 
 		// Show device methods
 		void show_device();
 		void show_device(cl::Device);
+
+	private:
+
+		// Build variant into the LRU of programs
+		cl::Program build_specialized(const std::string&, const std::string&, bool report = true);
 };
 
 // Null Constructor
-cl_device::cl_device(void) { }
+cl_device::cl_device(void) { this->kernel_lock = std::make_shared<std::mutex>(); }
 
 // Destructor
 cl_device::~cl_device(void) { }
@@ -85,6 +190,29 @@ cl_device::cl_device( cl::Device device )
 	// Establish context (runtime link)
 	cl::Context context({this->device});
  	this->context = context;
+
+	// Buffer pool for context
+	this->pool = std::make_shared<cl_buffer_pool>(this->context);
+
+	// Persistent command queue and kernel cache lock
+	this->queue = cl::CommandQueue(this->context, this->device);
+	this->kernel_lock = std::make_shared<std::mutex>();
+
+	// Integrated GPUs and CPU devices share memory with the host
+	this->host_unified = ( this->device.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>() == CL_TRUE );
+	this->zero_copy = this->host_unified;
+
+	// __local memory available to a workgroup
+	this->local_mem_size = (size_t)this->device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+	this->compute_units = (size_t)this->device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+	this->max_work_group_size = (size_t)this->device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+
+	// Tuning database for device and driver (see cl_tuning.cpp)
+	this->tuning.load(
+		this->binary_cache.cache_dir,
+		this->device.getInfo<CL_DEVICE_NAME>(),
+		this->device.getInfo<CL_DRIVER_VERSION>()
+	);
 }
 
 // Error strings defined in cl_error.cpp
@@ -96,39 +224,396 @@ const char* cl_device::get_error_string(cl_int error){
 void cl_device::kernel_source(const char* file){ 
 	this->kernels = cl_pkp(file); 
 	this->kernels.pkp_compile_all();
+	this->embedded_binaries = NULL;
+	this->n_embedded_binaries = 0;
+
+	// Specialized variants belong to the previous sources
+	this->specialized.clear();
+	this->specialized_lru.clear();
+	this->launch_count.clear();
 }
 
-// Method to build kernel sources
+// Kernel source embedded at build time (see utils/src/acl-embed.cpp)
+void cl_device::kernel_source(const cl_embedded_source& source){ 
+	this->kernels = cl_pkp(source);
+	this->embedded_binaries = source.binaries;
+	this->n_embedded_binaries = source.n_binaries;
+
+	// Specialized variants belong to the previous sources
+	this->specialized.clear();
+	this->specialized_lru.clear();
+	this->launch_count.clear();
+}
+
+// Method to build kernel sources (the digest) into the device program
 void cl_device::build_sources(void){
 
-	// Load digest as kernel source
+	// Lazy builds: warm up every kernel in the background (see get_program)
+	if ( this->lazy_build ){
+
+		if ( !this->build_queue ){
+			this->build_queue = std::make_shared<cl_build_queue>( this->build_threads );
+		}
+
+		// Builds run on a device which only holds the build settings at the 
+		// time of the call (no kernels, queue or buffers)
+		std::shared_ptr<cl_device> builder = std::make_shared<cl_device>();
+		builder->device = this->device;
+		builder->context = this->context;
+		builder->build_options = this->build_options;
+		builder->cache_binaries = this->cache_binaries;
+		builder->binary_cache = this->binary_cache;
+		builder->embedded_binaries = this->embedded_binaries;
+		builder->n_embedded_binaries = this->n_embedded_binaries;
+		this->builder = builder;
+
+		// Programs of previous sources are released
+		std::set<std::string> keys;
+		for ( std::string kernel_name : this->kernels.kernel_names ){
+			keys.insert( this->binary_cache.key( this->kernels.kernels[ kernel_name ].kernel_pkp, "", "", this->build_options ) );
+		}
+		this->build_queue->retain( keys );
+
+		for ( std::string kernel_name : this->kernels.kernel_names ){
+
+			std::string source = this->kernels.kernels[ kernel_name ].kernel_pkp;
+			this->build_queue->warm( 
+				this->binary_cache.key( source, "", "", this->build_options ), 
+				[builder, source]{ return builder->build_program( source, false ); } 
+			);
+		}
+
+		// Cached kernels may refer to previous sources
+		std::lock_guard<std::mutex> guard(*this->kernel_lock);
+		this->kernel_cache.clear();
+		return;
+	}
+
+	this->program = this->build_program( this->kernels.get_digest() );
+
+	// Cached kernels refer to the previous program
+	std::lock_guard<std::mutex> guard(*this->kernel_lock);
+	this->kernel_cache.clear();
+}
+
+// Method to build a program from source. Program binaries are cached on disk 
+// keyed by the source, device and build options so later runs skip compilation.
+// Binaries embedded with the sources are tried before the cache. Build errors
+// are reported (and exit) unless report is false, in which case they are thrown
+// as cl_build_error.
+cl::Program cl_device::build_program(const std::string& SOURCE, bool report){
+
+	// Load kernel source
 	cl::Program::Sources sources;
-	std::string SOURCE = this->kernels.get_digest();
 	sources.push_back({SOURCE.c_str(), SOURCE.length()});
 
+	// Calculate binary cache key
+	std::string key = this->binary_cache.key(
+		SOURCE,
+		this->device.getInfo<CL_DEVICE_NAME>(),
+		this->device.getInfo<CL_DRIVER_VERSION>(),
+		this->build_options
+	);
+
+	// Try to load program from embedded binary
+	for ( size_t i = 0; i < this->n_embedded_binaries; i++ ){
+
+		const cl_embedded_binary& embedded = this->embedded_binaries[i];
+		if ( key != embedded.key ){
+			continue;
+		}
+
+		try {
+			cl::Program::Binaries binaries(1, std::vector<unsigned char>( embedded.binary, embedded.binary + embedded.size ));
+			cl::Program program(this->context, {this->device}, binaries);
+			program.build({this->device}, this->build_options.c_str());
+			return program;
+		}
+
+		// Invalid binary. Fall through to the cache
+		catch (cl::Error& e) { }
+	}
+
+	// Try to load program from cached binary
+	std::vector<unsigned char> binary;
+	if ( this->cache_binaries && this->binary_cache.load(key, binary) ){
+
+		try {
+			cl::Program::Binaries binaries(1, binary);
+			cl::Program program(this->context, {this->device}, binaries);
+			program.build({this->device}, this->build_options.c_str());
+			return program;
+		}
+
+		// Stale or invalid binary. Fall through and compile from source
+		catch (cl::Error& e) { }
+	}
+
 	// cl::Program declared here for to maintain catch block scope
 	cl::Program program(this->context, sources);
 
-	// Try to build kernel and assign data member
+	// Try to build kernel
 	try {
-		program.build({this->device});
-		this->program = program;
+		program.build({this->device}, this->build_options.c_str());
 	}
 
-	// If build fails then report compile errors 	
+	// If build fails then report compile errors (or throw them)
 	catch (cl::Error& e) {
 
-		printf("Build Error(%d): %s\n", e.err(), this->get_error_string( e.err() ) );
-		printf("  what(): %s\n", e.what() );
-		
-		std::cerr<<"\n"<<program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(this->device)<<"\n";
-		exit(1);
+		cl_build_error error;
+		error.err = e.err();
+		error.what = e.what();
+		error.log = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(this->device);
+
+		if ( !report ){
+			throw error;
+		}
+		this->build_error( error );
 	}	
+
+	// Store program binary
+	if ( this->cache_binaries ){
+
+		try {
+			cl::Program::Binaries binaries = program.getInfo<CL_PROGRAM_BINARIES>();
+			if ( !binaries.empty() ){
+				this->binary_cache.store(key, binaries[0]);
+			}
+		}
+
+		// Binaries are an optimization only
+		catch (cl::Error& e) { }
+	}
+	return program;
 }
 
-// Method to return compuled kernel source for enqueueNDR
+// Method to return compiled kernel for enqueueNDR. Kernel objects are 
+// created on first use and then reused by the calling thread.
 cl::Kernel cl_device::get_kernel(const char* kernel_name){
- 	return cl::Kernel(this->program, kernel_name);
+
+	// Cache lookup
+	cl_kernel_key key( std::this_thread::get_id(), std::string(kernel_name) );
+	{
+		std::lock_guard<std::mutex> guard(*this->kernel_lock);
+		std::map<cl_kernel_key, cl::Kernel>::iterator it = this->kernel_cache.find(key);
+		if ( it != this->kernel_cache.end() ){
+			return it->second;
+		}
+	}
+
+	// Create kernel (lazy builds run here, without holding the lock) and cache
+	cl::Kernel kernel( this->get_program( key.second ), kernel_name );
+
+	std::lock_guard<std::mutex> guard(*this->kernel_lock);
+	this->kernel_cache[ key ] = kernel;
+ 	return kernel;
+}
+
+// Method to return the program containing a kernel. Variants have programs of 
+// their own, as do all kernels when builds are lazy. A lazy build of the 
+// kernel is claimed by the caller unless a background build is already in 
+// progress, so only the requested kernel is waited on.
+cl::Program cl_device::get_program(const std::string& kernel_name){
+
+	std::string source;
+	bool digest = false;
+	{
+		std::lock_guard<std::mutex> guard(*this->kernel_lock);
+		std::map<std::string, cl::Program>::iterator p = this->specialized.find( kernel_name );
+		if ( p != this->specialized.end() ){
+			return p->second;
+		}
+
+		std::map<std::string, cl_src>::iterator src = this->kernels.kernels.find( kernel_name );
+		if ( src == this->kernels.kernels.end() ){
+			return this->program;
+		}
+		source = src->second.kernel_pkp;
+		digest = ( std::find( this->kernels.kernel_names.begin(), this->kernels.kernel_names.end(), kernel_name ) 
+			!= this->kernels.kernel_names.end() );
+	}
+
+	if ( !digest ){
+		return this->build_specialized( kernel_name, source );
+	}
+
+	if ( this->lazy_build && this->build_queue ){
+
+		// Build errors (possibly of a background build) are reported here
+		try {
+			std::shared_ptr<cl_device> builder = this->builder;
+			return this->build_queue->get( 
+				this->binary_cache.key( source, "", "", this->build_options ), 
+				[builder, source]{ return builder->build_program( source, false ); } 
+			);
+		}
+		catch (cl_build_error& e) {
+			this->build_error( e );
+		}
+	}
+	return this->program;
+}
+
+// Report build error and exit
+void cl_device::build_error(const cl_build_error& error){
+
+	printf("Build Error(%d): %s\n", error.err, this->get_error_string( error.err ) );
+	printf("  what(): %s\n", error.what.c_str() );
+	
+	std::cerr<<"\n"<<error.log<<"\n";
+	exit(1);
+}
+
+// PKP lookups. The PKP map changes when variants are added, so reads which 
+// may run alongside launches on other threads go through these.
+bool cl_device::has_kernel(const std::string& kernel_name){
+
+	std::lock_guard<std::mutex> guard(*this->kernel_lock);
+	return ( this->kernels.kernels.find( kernel_name ) != this->kernels.kernels.end() );
+}
+
+std::string cl_device::get_base(const std::string& kernel_name){
+
+	std::lock_guard<std::mutex> guard(*this->kernel_lock);
+	return this->kernels.get_base( kernel_name );
+}
+
+// PKP values of a kernel (empty if not found)
+std::map<std::string, std::string> cl_device::get_config(const std::string& kernel_name){
+
+	std::lock_guard<std::mutex> guard(*this->kernel_lock);
+	std::map<std::string, cl_src>::iterator src = this->kernels.kernels.find( kernel_name );
+	return ( src != this->kernels.kernels.end() ) ? src->second.config_pkp : std::map<std::string, std::string>();
+}
+
+// PKP value of a kernel (see cl_pkp::get_config)
+std::string cl_device::get_config(const std::string& kernel_name, const std::string& constant){
+
+	std::lock_guard<std::mutex> guard(*this->kernel_lock);
+	return this->kernels.get_config( kernel_name, constant );
+}
+
+// Method to return a variant of a kernel with some pkp values replaced (see
+// cl_pkp::add_variant). Variants are built into programs of their own (see
+// get_specialized below), so a new variant does not rebuild the digest.
+std::string cl_device::get_variant(std::string kernel_name, std::map<std::string, std::string> config, bool report){
+	return this->get_specialized(kernel_name, config, report);
+}
+
+// Method to return a variant of a kernel which is built into a program of its 
+// own (see cl_pkp::add_variant), so that creating it does not rebuild the other 
+// kernels. Programs are kept in an LRU cache of specialize_capacity entries. 
+// Evicted variants are also removed from the PKP, so their names are no longer
+// valid: callers request variants again rather than keeping names (requesting
+// an evicted variant rebuilds it, usually from the binary cache). If report is
+// false then build errors are thrown (cl_build_error) and the variant removed.
+std::string cl_device::get_specialized(std::string kernel_name, std::map<std::string, std::string> config, bool report){
+
+	std::string variant_name, source;
+	{
+		std::lock_guard<std::mutex> guard(*this->kernel_lock);
+		variant_name = this->kernels.add_variant(kernel_name, config, false);
+
+		// Cache hit (move to front)
+		if ( this->specialized.find( variant_name ) != this->specialized.end() ){
+			this->specialized_lru.remove( variant_name );
+			this->specialized_lru.push_front( variant_name );
+			return variant_name;
+		}
+		source = this->kernels.kernels[ variant_name ].kernel_pkp;
+	}
+
+	try {
+		this->build_specialized( variant_name, source, report );
+	}
+	catch (cl_build_error& e) {
+		std::lock_guard<std::mutex> guard(*this->kernel_lock);
+		if ( this->specialized.find( variant_name ) == this->specialized.end() ){
+			this->kernels.remove_variant( variant_name );
+		}
+		throw;
+	}
+	return variant_name;
+}
+
+// Build variant (without holding the lock) and insert it into the LRU. If the
+// variant was built by another thread meanwhile then that program is kept.
+cl::Program cl_device::build_specialized(const std::string& variant_name, const std::string& source, bool report){
+
+	cl::Program program = this->build_program( source, report );
+
+	std::lock_guard<std::mutex> guard(*this->kernel_lock);
+	std::map<std::string, cl::Program>::iterator p = this->specialized.find( variant_name );
+	if ( p != this->specialized.end() ){
+		program = p->second;
+	}
+	else {
+		this->specialized[ variant_name ] = program;
+	}
+	this->specialized_lru.remove( variant_name );
+	this->specialized_lru.push_front( variant_name );
+
+	// Evict least recently used variants (program, kernel objects and source)
+	while ( this->specialized.size() > std::max( this->specialize_capacity, (size_t)1 ) ){
+
+		std::string evict = this->specialized_lru.back();
+		this->specialized_lru.pop_back();
+		this->specialized.erase( evict );
+		this->kernels.remove_variant( evict );
+
+		for ( auto it = this->kernel_cache.begin(); it != this->kernel_cache.end(); ){
+			it = ( it->first.second == evict ) ? this->kernel_cache.erase( it ) : std::next( it );
+		}
+	}
+	return program;
+}
+
+// Method to return the variant of a kernel specialized for a launch shape 
+// (SHAPE_M/N/K) once the shape has been launched specialize_after times. Until
+// then, or if the kernel has no shape constants, kernel_name is returned.
+std::string cl_device::get_specialized(std::string kernel_name, size_t M, size_t N, size_t K){
+
+	if ( this->specialize_after == 0 ){
+		return kernel_name;
+	}
+
+	// Count launches of shape (counts are reset when there are many shapes)
+	std::string key = kernel_name + ":" + std::to_string(M) + ":" + std::to_string(N) + ":" + std::to_string(K);
+	{
+		std::lock_guard<std::mutex> guard(*this->kernel_lock);
+
+		// Kernel must take shape constants (and not be specialized already)
+		std::map<std::string, cl_src>::iterator src = this->kernels.kernels.find( kernel_name );
+		if ( src == this->kernels.kernels.end() ||
+			 src->second.config_pkp.find("SHAPE_M") == src->second.config_pkp.end() ||
+			 src->second.config_pkp["SHAPE_M"] != "0" ){
+			return kernel_name;
+		}
+
+		if ( this->launch_count.size() > 64 * std::max( this->specialize_capacity, (size_t)1 ) ){
+			this->launch_count.clear();
+		}
+		if ( ++this->launch_count[ key ] < this->specialize_after ){
+			return kernel_name;
+		}
+	}
+
+	std::map<std::string, std::string> config;
+	config[ "SHAPE_M" ] = std::to_string(M);
+	config[ "SHAPE_N" ] = std::to_string(N);
+	config[ "SHAPE_K" ] = std::to_string(K);
+	return this->get_specialized(kernel_name, config);
+}
+
+// Method to return a pooled buffer. The buffer is released back into the 
+// pool when the last copy of the returned pointer goes out of scope.
+std::shared_ptr<cl::Buffer> cl_device::get_buffer(cl_mem_flags flags, size_t size){
+
+	std::shared_ptr<cl_buffer_pool> pool = this->pool;
+	return std::shared_ptr<cl::Buffer>( 
+		new cl::Buffer( pool->acquire(flags, size) ), 
+		[pool](cl::Buffer* buffer){ pool->release(*buffer); delete buffer; } 
+	);
 }
 
 // Wrapper method for below
@@ -154,6 +639,9 @@ void cl_device::show_device( cl::Device device ){
 	device.getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &size);
 	std::cout << "\t | __local Mem Size\t: " << size/1024 << " KB" << "\n";
 
+	// Device host unified memory (zero-copy)
+	std::cout << "\t | Host Unified Mem\t: " << ( device.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>() ? "yes" : "no" ) << "\n";
+
 	// Device workgroup size
 	device.getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, &size);
 	std::cout << "\t | Max Workgroup Size\t: " << size << "\n";
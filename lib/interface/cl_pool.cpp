@@ -0,0 +1,205 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> lib/interface/cl_pool.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+// Standard libraries
+#include <map>
+#include <mutex>
+#include <vector>
+#include <utility>
+
+// Default pool configuration
+#define CL_POOL_MIN_BUCKET 4096
+#define CL_POOL_CACHE_LIMIT (256*1024*1024)
+
+// Size bucketed caching allocator for cl::Buffer objects. Buffers are keyed by
+// (flags, capacity) and returned to a free list on release so that repeated
+// products of similar sizes do not pay driver allocation cost. Capacities are
+// rounded up to one eighth of the next power of two (waste <= 12.5%).
+class cl_buffer_pool {
+
+	public:
+
+		// Pool key (flags, capacity)
+		typedef std::pair<cl_mem_flags, size_t> cl_pool_key;
+
+		// Runtime link
+		cl::Context context;
+
+		// Free lists and buffers currently handed out
+		std::map<cl_pool_key, std::vector<cl::Buffer>> free_buffers;
+		std::map<cl_mem, cl_pool_key> used_buffers;
+
+		// Pool statistics (bytes)
+		size_t bytes_in_use;
+		size_t bytes_cached;
+		size_t high_water_mark;
+
+		// Pool statistics (calls)
+		size_t hits;
+		size_t misses;
+
+		// Maximum number of bytes to hold in free lists
+		size_t cache_limit;
+
+		// Constructors
+		cl_buffer_pool(cl::Context);
+		~cl_buffer_pool(void);
+
+		// Acquire and release buffers
+		cl::Buffer acquire(cl_mem_flags, size_t);
+		void release(cl::Buffer);
+
+		// Release cached buffers until at most (bytes) remain cached
+		void trim(size_t bytes = 0);
+
+		// Show pool statistics
+		void show_stats(void);
+
+	private:
+
+		// Calculate bucket capacity for a requested size
+		size_t bucket(size_t);
+
+		// Mutex for free lists and statistics
+		std::mutex lock;
+};
+
+// Constructor
+cl_buffer_pool::cl_buffer_pool(cl::Context context){
+
+	// Runtime link
+	this->context = context;
+
+	// Zero statistics
+	this->bytes_in_use = 0;
+	this->bytes_cached = 0;
+	this->high_water_mark = 0;
+	this->hits = 0;
+	this->misses = 0;
+
+	// Pool configuration
+	this->cache_limit = CL_POOL_CACHE_LIMIT;
+}
+
+// Destructor
+cl_buffer_pool::~cl_buffer_pool(void) { }
+
+// Bucket capacity: round up to 1/8th of next power of two
+size_t cl_buffer_pool::bucket(size_t size){
+
+	if ( size <= CL_POOL_MIN_BUCKET ){
+		return CL_POOL_MIN_BUCKET;
+	}
+
+	size_t p = CL_POOL_MIN_BUCKET;
+	while ( p < size ){ p <<= 1; }
+
+	size_t step = p >> 3;
+	return ( ( size + step - 1 ) / step ) * step;
+}
+
+// Acquire buffer from pool (allocate on miss)
+cl::Buffer cl_buffer_pool::acquire(cl_mem_flags flags, size_t size){
+
+	std::lock_guard<std::mutex> guard(this->lock);
+
+	// Pool key
+	cl_pool_key key( flags, this->bucket(size) );
+	cl::Buffer buffer;
+
+	// Hit: pop buffer from free list
+	std::map<cl_pool_key, std::vector<cl::Buffer>>::iterator it = this->free_buffers.find(key);
+	if ( it != this->free_buffers.end() && !it->second.empty() ){
+		buffer = it->second.back();
+		it->second.pop_back();
+		this->bytes_cached -= key.second;
+		this->hits++;
+	}
+
+	// Miss: allocate new buffer
+	else {
+		buffer = cl::Buffer(this->context, flags, key.second);
+		this->misses++;
+	}
+
+	// Update statistics
+	this->used_buffers[ buffer() ] = key;
+	this->bytes_in_use += key.second;
+	this->high_water_mark = std::max( this->high_water_mark, this->bytes_in_use + this->bytes_cached );
+
+	return buffer;
+}
+
+// Return buffer to pool
+void cl_buffer_pool::release(cl::Buffer buffer){
+
+	std::lock_guard<std::mutex> guard(this->lock);
+
+	// Buffer was not allocated by this pool
+	std::map<cl_mem, cl_pool_key>::iterator it = this->used_buffers.find( buffer() );
+	if ( it == this->used_buffers.end() ){
+		return;
+	}
+
+	// Update statistics
+	cl_pool_key key = it->second;
+	this->used_buffers.erase(it);
+	this->bytes_in_use -= key.second;
+
+	// Cache buffer if below limit (otherwise the handle drops here)
+	if ( this->bytes_cached + key.second <= this->cache_limit ){
+		this->free_buffers[ key ].push_back( buffer );
+		this->bytes_cached += key.second;
+	}
+}
+
+// Release cached buffers down to (bytes)
+void cl_buffer_pool::trim(size_t bytes){
+
+	std::lock_guard<std::mutex> guard(this->lock);
+
+	std::map<cl_pool_key, std::vector<cl::Buffer>>::reverse_iterator it = this->free_buffers.rbegin();
+	while ( this->bytes_cached > bytes && it != this->free_buffers.rend() ){
+
+		while ( this->bytes_cached > bytes && !it->second.empty() ){
+			it->second.pop_back();
+			this->bytes_cached -= it->first.second;
+		}
+		++it;
+	}
+}
+
+// Show pool statistics
+void cl_buffer_pool::show_stats(void){
+
+	std::lock_guard<std::mutex> guard(this->lock);
+
+	std::cout << "Buffer Pool\n";
+	std::cout << "\t | Hits/Misses\t\t: " << this->hits << "/" << this->misses << "\n";
+	std::cout << "\t | Bytes In Use\t\t: " << this->bytes_in_use/1024 << " KB" << "\n";
+	std::cout << "\t | Bytes Cached\t\t: " << this->bytes_cached/1024 << " KB" << "\n";
+	std::cout << "\t | High Water Mark\t: " << this->high_water_mark/1024 << " KB" << "\n\n";
+}
\ No newline at end of file
@@ -0,0 +1,343 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> lib/interface/cl_tuning.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+// Standard libraries
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+
+// Tuned launch of a product kernel for one shape bucket
+struct cl_tuning_entry {
+	std::string kernel_name;						// base kernel
+	std::map<std::string, std::string> config;		// PKP values (variant)
+	std::vector<size_t> local;						// workgroup shape (NDR) if used
+	double time_us;									// measured time per product
+};
+
+// Kernel tuning database. Autotuned product launches are stored per shape
+// bucket (see bucket()) in a JSON file per device and driver version:
+//
+//	<cache_dir>/tuning/<device name>-<driver version>.json
+//
+// where cache_dir is that of the program binary cache (cl_cache.cpp). The file
+// is loaded when a cl_device is constructed and is consulted by the product
+// kernel selector (cl_product_select) before its heuristic.
+class cl_tuning_db {
+
+	public:
+
+		// Database file (empty if disabled)
+		std::string path;
+
+		// Device identification (checked on load)
+		std::string device_name;
+		std::string driver_version;
+
+		// Tuned launches by shape bucket
+		std::map<std::string, cl_tuning_entry> entries;
+
+		// Constructors
+		cl_tuning_db(void);
+		~cl_tuning_db(void);
+
+		// Shape bucket of A(M,K)*B(K,N) with elements of m_size_t bytes
+		static std::string bucket(size_t M, size_t N, size_t K, size_t m_size_t);
+
+		// Load/store database for device (returns false if there is none)
+		bool load(const std::string& cache_dir, const std::string& device_name, const std::string& driver_version);
+		bool store(void);
+
+		// Lookup and update entries
+		const cl_tuning_entry* find(const std::string& bucket) const;
+		void update(const std::string& bucket, const cl_tuning_entry& entry);
+
+	private:
+
+		// Minimal JSON value (objects, arrays, strings and numbers)
+		struct cl_json {
+			char type = 0;	// '{', '[', '"' or '0'
+			std::string str;
+			double num = 0.0;
+			std::vector<cl_json> arr;
+			std::map<std::string, cl_json> obj;
+		};
+
+		// JSON reader and string escapes
+		static bool parse(const std::string& s, size_t& i, cl_json& value);
+		static bool parse_string(const std::string& s, size_t& i, std::string& str);
+		static std::string quote(const std::string& str);
+};
+
+// Constructor
+cl_tuning_db::cl_tuning_db(void) { }
+
+// Destructor
+cl_tuning_db::~cl_tuning_db(void) { }
+
+// Shape bucket: element type and ceil(log2) of each dimension, e.g. a 1000 x
+// 1000 x 1000 product of floats is "f32:10:10:10"
+std::string cl_tuning_db::bucket(size_t M, size_t N, size_t K, size_t m_size_t){
+
+	std::string key = "f" + std::to_string( 8*m_size_t );
+	for ( size_t d : { M, N, K } ){
+
+		size_t b = 0;
+		while ( ( (size_t)1 << b ) < d ){ b++; }
+		key.append( ":" + std::to_string(b) );
+	}
+	return key;
+}
+
+// Load database for device. Entries recorded for another device or driver
+// are ignored.
+bool cl_tuning_db::load(const std::string& cache_dir, const std::string& device_name, const std::string& driver_version){
+
+	this->device_name = device_name;
+	this->driver_version = driver_version;
+	this->entries.clear();
+	this->path.clear();
+
+	if ( cache_dir.empty() ){
+		return false;
+	}
+
+	// File name from device name and driver version
+	std::string file = device_name + "-" + driver_version;
+	for ( char& c : file ){
+		if ( !std::isalnum( (unsigned char)c ) && c != '.' && c != '-' ){
+			c = '_';
+		}
+	}
+	this->path = cache_dir + "/tuning/" + file + ".json";
+
+	std::ifstream f( this->path.c_str() );
+	if ( !f.is_open() ){
+		return false;
+	}
+
+	std::string s( (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>() );
+	size_t i = 0;
+	cl_json root;
+
+	if ( !cl_tuning_db::parse(s, i, root) || root.type != '{' ){
+		printf("Tuning Error: Unable to parse (%s)\n", this->path.c_str());
+		return false;
+	}
+
+	if ( root.obj["device"].str != device_name || root.obj["driver"].str != driver_version ){
+		return false;
+	}
+
+	for ( const cl_json& e : root.obj["entries"].arr ){
+
+		std::map<std::string, cl_json> obj = e.obj;
+
+		cl_tuning_entry entry;
+		entry.kernel_name = obj["kernel"].str;
+		entry.time_us = obj["time_us"].num;
+
+		for ( auto it = obj["config"].obj.cbegin(); it != obj["config"].obj.cend(); ++it ){
+			entry.config[ it->first ] = it->second.str;
+		}
+		for ( const cl_json& d : obj["local"].arr ){
+			entry.local.push_back( (size_t)d.num );
+		}
+
+		if ( !obj["bucket"].str.empty() && !entry.kernel_name.empty() ){
+			this->entries[ obj["bucket"].str ] = entry;
+		}
+	}
+	return true;
+}
+
+// Store database. Written to a temporary file and renamed (as binaries are).
+bool cl_tuning_db::store(void){
+
+	if ( this->path.empty() ){
+		return false;
+	}
+
+	// Create directory (cache_dir/tuning)
+	cl_binary_cache cache;
+	if ( !cache.make_dir( this->path.substr( 0, this->path.find_last_of('/') ) ) ){
+		return false;
+	}
+
+	std::string tmp = this->path + "." + std::to_string( getpid() ) + ".tmp";
+	std::ofstream f( tmp.c_str() );
+	if ( !f.is_open() ){
+		return false;
+	}
+
+	f << "{\n";
+	f << "\t\"device\": " << cl_tuning_db::quote(this->device_name) << ",\n";
+	f << "\t\"driver\": " << cl_tuning_db::quote(this->driver_version) << ",\n";
+	f << "\t\"entries\": [";
+
+	size_t count = 0;
+	for ( auto it = this->entries.cbegin(); it != this->entries.cend(); ++it ){
+
+		const cl_tuning_entry& entry = it->second;
+		f << ( count++ ? ",\n" : "\n" );
+		f << "\t\t{ \"bucket\": " << cl_tuning_db::quote(it->first);
+		f << ", \"kernel\": " << cl_tuning_db::quote(entry.kernel_name);
+
+		f << ", \"config\": {";
+		for ( auto c = entry.config.cbegin(); c != entry.config.cend(); ++c ){
+			f << ( c == entry.config.cbegin() ? " " : ", " );
+			f << cl_tuning_db::quote(c->first) << ": " << cl_tuning_db::quote(c->second);
+		}
+		f << " }";
+
+		f << ", \"local\": [";
+		for ( size_t d = 0; d < entry.local.size(); d++ ){
+			f << ( d ? ", " : " " ) << entry.local[d];
+		}
+		f << " ]";
+
+		f << ", \"time_us\": " << entry.time_us << " }";
+	}
+	f << "\n\t]\n}\n";
+	f.close();
+
+	if ( f.fail() || std::rename( tmp.c_str(), this->path.c_str() ) != 0 ){
+		std::remove( tmp.c_str() );
+		return false;
+	}
+	return true;
+}
+
+// Lookup entry (NULL if the bucket has not been tuned)
+const cl_tuning_entry* cl_tuning_db::find(const std::string& bucket) const {
+
+	std::map<std::string, cl_tuning_entry>::const_iterator it = this->entries.find( bucket );
+	return ( it != this->entries.end() ) ? &it->second : NULL;
+}
+
+// Update entry
+void cl_tuning_db::update(const std::string& bucket, const cl_tuning_entry& entry){
+	this->entries[ bucket ] = entry;
+}
+
+// Parse JSON value at s[i] (true and bools/null are read as numbers)
+bool cl_tuning_db::parse(const std::string& s, size_t& i, cl_json& value){
+
+	while ( i < s.size() && std::isspace( (unsigned char)s[i] ) ){ i++; }
+	if ( i >= s.size() ){
+		return false;
+	}
+
+	// Object
+	if ( s[i] == '{' ){
+
+		value.type = '{';
+		i++;
+		while ( true ){
+
+			while ( i < s.size() && std::isspace( (unsigned char)s[i] ) ){ i++; }
+			if ( i < s.size() && s[i] == '}' ){ i++; return true; }
+
+			std::string key;
+			if ( !cl_tuning_db::parse_string(s, i, key) ){ return false; }
+
+			while ( i < s.size() && std::isspace( (unsigned char)s[i] ) ){ i++; }
+			if ( i >= s.size() || s[i++] != ':' ){ return false; }
+			if ( !cl_tuning_db::parse(s, i, value.obj[ key ]) ){ return false; }
+
+			while ( i < s.size() && std::isspace( (unsigned char)s[i] ) ){ i++; }
+			if ( i < s.size() && s[i] == ',' ){ i++; }
+		}
+	}
+
+	// Array
+	if ( s[i] == '[' ){
+
+		value.type = '[';
+		i++;
+		while ( true ){
+
+			while ( i < s.size() && std::isspace( (unsigned char)s[i] ) ){ i++; }
+			if ( i < s.size() && s[i] == ']' ){ i++; return true; }
+
+			value.arr.push_back( cl_json() );
+			if ( !cl_tuning_db::parse(s, i, value.arr.back()) ){ return false; }
+
+			while ( i < s.size() && std::isspace( (unsigned char)s[i] ) ){ i++; }
+			if ( i < s.size() && s[i] == ',' ){ i++; }
+		}
+	}
+
+	// String
+	if ( s[i] == '"' ){
+		value.type = '"';
+		return cl_tuning_db::parse_string(s, i, value.str);
+	}
+
+	// Number (or literal)
+	size_t j = i;
+	while ( j < s.size() && ( std::isalnum( (unsigned char)s[j] ) || s[j] == '-' || s[j] == '+' || s[j] == '.' ) ){ j++; }
+	if ( j == i ){
+		return false;
+	}
+	value.type = '0';
+	value.num = std::strtod( s.substr(i, j - i).c_str(), NULL );
+	i = j;
+	return true;
+}
+
+// Parse JSON string at s[i]
+bool cl_tuning_db::parse_string(const std::string& s, size_t& i, std::string& str){
+
+	if ( i >= s.size() || s[i] != '"' ){
+		return false;
+	}
+
+	for ( i++; i < s.size(); i++ ){
+
+		if ( s[i] == '"' ){ i++; return true; }
+		if ( s[i] == '\\' && i + 1 < s.size() ){ i++; }
+		str.push_back( s[i] );
+	}
+	return false;
+}
+
+// Quote and escape JSON string
+std::string cl_tuning_db::quote(const std::string& str){
+
+	std::string q = "\"";
+	for ( char c : str ){
+		if ( c == '"' || c == '\\' ){
+			q.push_back('\\');
+		}
+		q.push_back(c);
+	}
+	return q + "\"";
+}
